@@ -72,11 +72,10 @@ AudioConnection          patchCord8(mixer1, 0, i2s2, 1);
 AudioConnection          patchCord10(mixer1, amp2);
 // GUItool: end automatically generated code
 
-// NOTE: Connections are most efficient when made from an earlier 
-//       object (in the order they are created) to a later one. 
-//       Connections from a later object back to an earlier object 
-//       can be made, but they add a 1-block delay and consume more 
-//       memory to implement that delay. 
+// NOTE: Objects are updated in data flow order, whatever the order
+//       they are created in.  Only connections that close a feedback
+//       loop add a 1-block delay (and consume more memory to
+//       implement that delay). 
 
 void audioTask( void * parameter ) {
   AudioStream *p;  
@@ -87,6 +86,7 @@ void audioTask( void * parameter ) {
 
 void setup() {
     Serial.begin(115200);
+    //AudioSampleRate(48000); // before ac101.begin() and i2s.ac101()
     AudioMemory(40); 
 
     amp1.gain(0.2);
@@ -111,6 +111,7 @@ void setup() {
     i2s.ac101();
     ESP_LOGI(TAG, "Starting audiotask");
     xTaskCreatePinnedToCore(audioTask, "AudioTask", 4096, NULL, 24, NULL, 1);
+    //AudioStream::enable_parallel_update(0); // run independent branches on core 0 too
 
     pinMode(2,OUTPUT);
     pinMode(5,INPUT_PULLUP);
@@ -48,11 +48,10 @@ AudioConnection          patchCord8(mixer1, 0, i2s2, 1);
 AudioConnection          patchCord10(mixer1, amp2);
 // GUItool: end automatically generated code
 
-// NOTE: Connections are most efficient when made from an earlier 
-//       object (in the order they are created) to a later one. 
-//       Connections from a later object back to an earlier object 
-//       can be made, but they add a 1-block delay and consume more 
-//       memory to implement that delay. 
+// NOTE: Objects are updated in data flow order, whatever the order
+//       they are created in.  Only connections that close a feedback
+//       loop add a 1-block delay (and consume more memory to
+//       implement that delay). 
 
 void audioTask( void * parameter ) {
   AudioStream *p;  
@@ -0,0 +1,67 @@
+/* Example: render a WAV file through a graph on a PC
+ *
+ * The host build (pio run -e native) runs the library without the
+ * ESP32: AudioInputI2S reads a WAV file, AudioOutputI2S writes one, and
+ * update_all() goes as fast as the CPU allows.  Put a production graph
+ * here to render hours of audio in seconds, for regression tests or to
+ * tune it.
+ *
+ * .pio/build/native/program input.wav output.wav
+ *
+ */
+
+#include "Audio.h"
+#include "effect_biquad.h"
+#include "AudioHostWav.h"
+#include <chrono>
+
+// GUItool: begin automatically generated code
+AudioInputI2S            i2s1;           //xy=200,400
+AudioFilterBiquad        biquad1;        //xy=380,400
+AudioEffectDelay         delay1;         //xy=560,480
+AudioMixer4              mixer1;         //xy=740,420
+AudioSynthControlLFO     lfo1;           //xy=740,520
+AudioAmplifier           amp1;           //xy=900,420
+AudioOutputI2S           i2s2;           //xy=1080,400
+AudioConnection          patchCord1(i2s1, 0, biquad1, 0);
+AudioConnection          patchCord2(biquad1, 0, mixer1, 0);
+AudioConnection          patchCord3(biquad1, 0, delay1, 0);
+AudioConnection          patchCord4(delay1, 0, mixer1, 1);
+AudioConnection          patchCord5(mixer1, 0, amp1, 0);
+AudioControlConnection   patchCord6(lfo1, amp1);
+AudioConnection          patchCord7(amp1, 0, i2s2, 0);
+AudioConnection          patchCord8(amp1, 0, i2s2, 1);
+// GUItool: end automatically generated code
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        printf("usage: %s input.wav output.wav\n", argv[0]);
+        return 1;
+    }
+    if (!AudioHostWav::input(argv[1]) || !AudioHostWav::output(argv[2])) return 1;
+
+    biquad1.lowpass(4000, 0.7);
+    delay1.delay(0, 250);
+    mixer1.gain(0, 0.7);
+    mixer1.gain(1, 0.3);
+    lfo1.amplitude(0.3);
+    lfo1.offset(0.7);
+    lfo1.frequency(5.0);
+    lfo1.begin(WAVEFORM_SINE);
+    // after the delay is set, so the pool has room for its blocks
+    AudioMemoryPlanned(4);
+
+    auto start = std::chrono::steady_clock::now();
+    while (!AudioHostWav::finished()) {
+        AudioContext::global().update_all();
+    }
+    std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+    AudioHostWav::close();
+
+    double seconds = (double)AudioHostWav::outputFrames / AudioContext::global().sample_rate;
+    printf("%.1f s of audio in %.3f s, %.0fx real time\n", seconds, took.count(), seconds / took.count());
+    printf("Audio memory: %u blocks used [%u max] of %u\n", AudioContext::global().memory_used,
+        AudioContext::global().memory_used_max, AudioContext::global().memory_size);
+    return 0;
+}
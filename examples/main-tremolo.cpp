@@ -20,27 +20,27 @@
 #include "control_i2s.h"
 #include "effect_delay_ext.h"
 #include "effect_biquad.h"
-#include "effect_multiply.h"
-#include "synth_sine.h"
-#include "synth_waveform.h"
+#include "synth_control.h"
 
 
 // GUItool: begin automatically generated code
 AudioInputI2S            i2s1;           //xy=263,412
-AudioSynthWaveform       waveform1;      //xy=355,518
-AudioEffectMultiply      multiply1;      //xy=599,419
+AudioSynthControlLFO     lfo1;           //xy=355,518
+AudioAmplifier           amp1;           //xy=599,419
 AudioOutputI2S           i2s2;           //xy=879,404
-AudioConnection          patchCord1(i2s1, 1, multiply1, 0);
-AudioConnection          patchCord2(waveform1, 0, multiply1, 1);
-AudioConnection          patchCord3(multiply1, 0, i2s2, 1);
+AudioConnection          patchCord1(i2s1, 1, amp1, 0);
+AudioControlConnection   patchCord2(lfo1, amp1);
+AudioConnection          patchCord3(amp1, 0, i2s2, 1);
 // GUItool: end automatically generated code
 
+// NOTE: The LFO runs at control rate, one value per block, and the amp
+//       ramps its gain between them: no 4 Hz waveform at 44.1 kHz.
 
-// NOTE: Connections are most efficient when made from an earlier 
-//       object (in the order they are created) to a later one. 
-//       Connections from a later object back to an earlier object 
-//       can be made, but they add a 1-block delay and consume more 
-//       memory to implement that delay. 
+
+// NOTE: Objects are updated in data flow order, whatever the order
+//       they are created in.  Only connections that close a feedback
+//       loop add a 1-block delay (and consume more memory to
+//       implement that delay). 
 
 
 #define CODEC_SCK       (GPIO_NUM_32)
@@ -91,11 +91,10 @@ void setup() {
     Serial.begin(115200);
     AudioMemory(40); 
 
-    waveform1.amplitude(0.7);
-    waveform1.frequency(4.0);
-    waveform1.offset(0.3);
-    //waveform1.pulseWidth(0.8);
-    waveform1.begin(WAVEFORM_SINE);    
+    lfo1.amplitude(0.7);
+    lfo1.frequency(4.0);
+    lfo1.offset(0.3);
+    lfo1.begin(WAVEFORM_SINE);    
 
     ESP_LOGI(TAG, "I2C");
     if(!ac101.begin(CODEC_SDA, CODEC_SCK)) 
@@ -145,13 +144,13 @@ void loop () {
 
   if(f1 != o_amplitude) {
       o_amplitude = f1;
-      waveform1.amplitude(o_amplitude); // TC :)
+      lfo1.amplitude(o_amplitude); // TC :)
       Serial.print("Amplitude = ");
       Serial.println(o_amplitude);
   }
   if(f2 != o_frequency) {
       o_frequency = f2;
-      waveform1.frequency(o_frequency*10); // TC :)
+      lfo1.frequency(o_frequency*10); // TC :)
       Serial.print("Frequency = ");
       Serial.println(o_frequency*10);
   }
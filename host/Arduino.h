@@ -0,0 +1,50 @@
+#ifndef host_Arduino_h_
+#define host_Arduino_h_
+
+// Host build: the parts of the Arduino core that the audio objects use
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#define PI 3.1415926535897932384626433832795
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+// The clock of the calling thread, counted at the ESP32's rate, so the
+// clocks in the CPU statistics compare with the device
+uint32_t xthal_get_ccount(void);
+
+unsigned long millis(void);
+void delay(uint32_t ms);
+long random(long howbig);
+long random(long howsmall, long howbig);
+
+static inline void *ps_malloc(size_t size) { return malloc(size); }
+static inline void *ps_calloc(size_t n, size_t size) { return calloc(n, size); }
+
+// Serial prints to stdout
+class HostSerial
+{
+public:
+	void begin(unsigned long baud) { (void)baud; }
+	void print(const char *s) { fputs(s, stdout); }
+	void print(char c) { putchar(c); }
+	void print(int n) { printf("%d", n); }
+	void print(unsigned int n) { printf("%u", n); }
+	void print(long n) { printf("%ld", n); }
+	void print(unsigned long n) { printf("%lu", n); }
+	void print(double n) { printf("%.2f", n); }
+	template <typename T> void println(T value) { print(value); putchar('\n'); }
+	void println(void) { putchar('\n'); }
+};
+extern HostSerial Serial;
+
+#endif
@@ -0,0 +1,30 @@
+#ifndef AudioHostWav_h_
+#define AudioHostWav_h_
+
+#include <stdint.h>
+
+// Host build: AudioInputI2S reads a WAV file and AudioOutputI2S writes
+// one, in place of the codec, as does AudioIOI2S.  Nothing waits for a DMA buffer, so each
+// update_all() renders a block as fast as the CPU allows:
+//
+//   AudioHostWav::input("in.wav");
+//   AudioHostWav::output("out.wav");
+//   while (!AudioHostWav::finished()) AudioContext::global().update_all();
+//   AudioHostWav::close();
+class AudioHostWav
+{
+public:
+	// 1 or 2 channels, any format dr_wav reads; the graph's sample rate
+	// becomes the file's.  Without an input file the graph gets silence.
+	static bool input(const char *path);
+	// 2 channels of 32-bit float, at the graph's sample rate
+	static bool output(const char *path);
+	// The input file has run out: its last block has gone into the graph
+	static bool finished(void);
+	// Closes both files, which also completes the output file's header
+	static void close(void);
+	static uint64_t inputFrames;
+	static uint64_t outputFrames;
+};
+
+#endif
@@ -0,0 +1,6 @@
+#ifndef host_FreeRTOS_h_
+#define host_FreeRTOS_h_
+
+#include "freertos/FreeRTOS.h"
+
+#endif
@@ -0,0 +1,79 @@
+#ifndef host_driver_i2s_h_
+#define host_driver_i2s_h_
+
+// Host build: the I2S types of the ESP-IDF driver, for the headers of
+// the I2S objects.  There is no driver: AudioInputI2S and AudioOutputI2S
+// read and write WAV files instead, see AudioHostWav.h.
+
+#include "freertos/FreeRTOS.h"
+
+typedef enum { I2S_NUM_0 = 0, I2S_NUM_1 = 1, I2S_NUM_MAX } i2s_port_t;
+
+typedef enum {
+	I2S_BITS_PER_SAMPLE_8BIT = 8,
+	I2S_BITS_PER_SAMPLE_16BIT = 16,
+	I2S_BITS_PER_SAMPLE_24BIT = 24,
+	I2S_BITS_PER_SAMPLE_32BIT = 32,
+} i2s_bits_per_sample_t;
+
+typedef enum { I2S_CHANNEL_MONO = 1, I2S_CHANNEL_STEREO = 2 } i2s_channel_t;
+
+typedef enum {
+	I2S_MODE_MASTER = 1,
+	I2S_MODE_SLAVE = 2,
+	I2S_MODE_TX = 4,
+	I2S_MODE_RX = 8,
+} i2s_mode_t;
+
+typedef enum {
+	I2S_CHANNEL_FMT_RIGHT_LEFT = 0,
+	I2S_CHANNEL_FMT_ALL_RIGHT,
+	I2S_CHANNEL_FMT_ALL_LEFT,
+	I2S_CHANNEL_FMT_ONLY_RIGHT,
+	I2S_CHANNEL_FMT_ONLY_LEFT,
+} i2s_channel_fmt_t;
+
+typedef enum {
+	I2S_COMM_FORMAT_I2S = 0x01,
+	I2S_COMM_FORMAT_I2S_MSB = 0x02,
+	I2S_COMM_FORMAT_I2S_LSB = 0x04,
+} i2s_comm_format_t;
+
+typedef struct {
+	i2s_mode_t mode;
+	int sample_rate;
+	i2s_bits_per_sample_t bits_per_sample;
+	i2s_channel_fmt_t channel_format;
+	i2s_comm_format_t communication_format;
+	int intr_alloc_flags;
+	int dma_buf_count;
+	int dma_buf_len;
+	bool use_apll;
+	bool tx_desc_auto_clear;
+	int fixed_mclk;
+} i2s_config_t;
+
+typedef enum {
+	I2S_EVENT_DMA_ERROR = 0,
+	I2S_EVENT_TX_DONE,
+	I2S_EVENT_RX_DONE,
+	I2S_EVENT_TX_Q_OVF,
+	I2S_EVENT_RX_Q_OVF,
+	I2S_EVENT_MAX,
+} i2s_event_type_t;
+
+typedef struct {
+	i2s_event_type_t type;
+	size_t size;
+} i2s_event_t;
+
+#define I2S_PIN_NO_CHANGE (-1)
+
+typedef struct {
+	int bck_io_num;
+	int ws_io_num;
+	int data_out_num;
+	int data_in_num;
+} i2s_pin_config_t;
+
+#endif
@@ -0,0 +1,7 @@
+#ifndef host_driver_sdspi_host_h_
+#define host_driver_sdspi_host_h_
+
+// Host build: the codec and SD card objects are not built, their
+// headers only include this
+
+#endif
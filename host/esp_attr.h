@@ -0,0 +1,8 @@
+#ifndef host_esp_attr_h_
+#define host_esp_attr_h_
+
+// Host build: no internal RAM to place code and data in
+#define IRAM_ATTR
+#define DRAM_ATTR
+
+#endif
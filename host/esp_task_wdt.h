@@ -0,0 +1,11 @@
+#ifndef host_esp_task_wdt_h_
+#define host_esp_task_wdt_h_
+
+// Host build: no task watchdog
+#include "freertos/FreeRTOS.h"
+
+static inline esp_err_t esp_task_wdt_add(TaskHandle_t handle) { (void)handle; return ESP_OK; }
+static inline esp_err_t esp_task_wdt_delete(TaskHandle_t handle) { (void)handle; return ESP_OK; }
+static inline esp_err_t esp_task_wdt_reset(void) { return ESP_OK; }
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef host_freertos_FreeRTOS_h_
+#define host_freertos_FreeRTOS_h_
+
+// Host build: FreeRTOS tasks on threads, see freertos_host.cpp
+
+#include <stdint.h>
+#include <stddef.h>
+// which the ESP-IDF headers bring in too
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+typedef uint32_t TickType_t;
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS 1
+#define pdFAIL 0
+
+#define portMAX_DELAY ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS (1000 / configTICK_RATE_HZ)
+#define portTICK_RATE_MS portTICK_PERIOD_MS
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms) * configTICK_RATE_HZ / 1000)
+
+// The clock the CPU statistics assume
+#ifndef CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ
+#define CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ 240
+#endif
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef host_freertos_queue_h_
+#define host_freertos_queue_h_
+
+// Host build: the queue handle, for the I2S driver's event queue.  There
+// are no queues: nothing on the host posts to one.
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_queue *QueueHandle_t;
+
+#endif
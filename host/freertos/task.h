@@ -0,0 +1,24 @@
+#ifndef host_freertos_task_h_
+#define host_freertos_task_h_
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *);
+
+// Tasks are threads, and the core they are pinned to is only reported
+// back by xPortGetCoreID(): the threads run wherever the OS puts them.
+// The thread that calls main() counts as the Arduino loop task, on core 1.
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stack,
+	void *parameter, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core);
+// Deleting another task waits for it to next block in one of these calls
+void vTaskDelete(TaskHandle_t handle);
+void vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+BaseType_t xTaskNotifyGive(TaskHandle_t handle);
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks);
+BaseType_t xPortGetCoreID(void);
+void vPortYield(void);
+
+#endif
@@ -0,0 +1,172 @@
+// Host build: the FreeRTOS and Arduino calls of the audio library, on
+// C++ threads.  Task notifications are a counter under a mutex; ticks
+// are milliseconds.
+
+#include "Arduino.h"
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <random>
+#include <thread>
+
+struct host_task {
+	TaskFunction_t code;
+	void *parameter;
+	int core;
+	std::mutex lock;
+	std::condition_variable wake;
+	uint32_t notified;
+	bool deleted;
+	bool finished;
+};
+
+// Thrown through a task's code to end it, from vTaskDelete()
+struct host_task_deleted { };
+
+static thread_local host_task *self;
+static const std::chrono::steady_clock::time_point host_start = std::chrono::steady_clock::now();
+
+HostSerial Serial;
+
+// The task of the calling thread, made on first use for main()
+static host_task *current(void)
+{
+	if (!self) {
+		self = new host_task();
+		self->core = 1;
+	}
+	return self;
+}
+
+// Called where a task blocks: leave if it was deleted meanwhile
+static void check_deleted(host_task *task, std::unique_lock<std::mutex> &hold)
+{
+	if (task->deleted) {
+		hold.unlock();
+		throw host_task_deleted();
+	}
+}
+
+static void run(host_task *task)
+{
+	self = task;
+	try {
+		task->code(task->parameter);
+	} catch (host_task_deleted &) {
+	}
+	std::lock_guard<std::mutex> hold(task->lock);
+	task->finished = true;
+	task->wake.notify_all();
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t code, const char *name, uint32_t stack,
+	void *parameter, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+	(void)name; (void)stack; (void)priority;
+	// tasks are never freed: a deleted one may still be waited on
+	host_task *task = new host_task();
+	task->code = code;
+	task->parameter = parameter;
+	task->core = core;
+	if (handle) *handle = task;
+	std::thread(run, task).detach();
+	return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t handle)
+{
+	host_task *task = handle ? handle : current();
+	std::unique_lock<std::mutex> hold(task->lock);
+	task->deleted = true;
+	if (task == self) {
+		hold.unlock();
+		throw host_task_deleted();
+	}
+	task->wake.notify_all();
+	task->wake.wait(hold, [task] { return task->finished; });
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+	host_task *task = current();
+	std::unique_lock<std::mutex> hold(task->lock);
+	task->wake.wait_for(hold, std::chrono::milliseconds(ticks * portTICK_PERIOD_MS),
+		[task] { return task->deleted; });
+	check_deleted(task, hold);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+	return (TickType_t)millis() / portTICK_PERIOD_MS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+	return current();
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t handle)
+{
+	std::lock_guard<std::mutex> hold(handle->lock);
+	handle->notified++;
+	handle->wake.notify_all();
+	return pdPASS;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear, TickType_t ticks)
+{
+	host_task *task = current();
+	std::unique_lock<std::mutex> hold(task->lock);
+	auto ready = [task] { return task->notified || task->deleted; };
+	if (ticks == portMAX_DELAY) {
+		task->wake.wait(hold, ready);
+	} else {
+		task->wake.wait_for(hold, std::chrono::milliseconds(ticks * portTICK_PERIOD_MS), ready);
+	}
+	check_deleted(task, hold);
+	uint32_t count = task->notified;
+	if (count) task->notified = clear ? 0 : count - 1;
+	return count;
+}
+
+BaseType_t xPortGetCoreID(void)
+{
+	return current()->core;
+}
+
+void vPortYield(void)
+{
+	std::this_thread::yield();
+}
+
+uint32_t xthal_get_ccount(void)
+{
+	auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+		std::chrono::steady_clock::now() - host_start).count();
+	return (uint32_t)((uint64_t)ns * CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ / 1000);
+}
+
+unsigned long millis(void)
+{
+	return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+		std::chrono::steady_clock::now() - host_start).count();
+}
+
+void delay(uint32_t ms)
+{
+	vTaskDelay(ms / portTICK_PERIOD_MS);
+}
+
+static std::minstd_rand host_random;
+
+long random(long howbig)
+{
+	if (howbig <= 0) return 0;
+	return (long)(host_random() % (unsigned long)howbig);
+}
+
+long random(long howsmall, long howbig)
+{
+	if (howsmall >= howbig) return howsmall;
+	return howsmall + random(howbig - howsmall);
+}
@@ -0,0 +1,228 @@
+// Host build: the I2S objects on WAV files, see AudioHostWav.h
+
+#define DR_WAV_IMPLEMENTATION
+#include "../lib/dr_wav/dr_wav.h"
+#include "AudioHostWav.h"
+#include "control_i2s.h"
+#include "AudioKernels.h"
+
+static const char *TAG = "AudioHostWav";
+
+static drwav input_wav, output_wav;
+static bool input_open, output_open, input_done;
+
+uint64_t AudioHostWav::inputFrames = 0;
+uint64_t AudioHostWav::outputFrames = 0;
+
+bool AudioControlI2S::configured = false;
+uint8_t AudioControlI2S::bits = 32;
+uint8_t AudioControlI2S::buffer_count = AUDIO_I2S_DMA_BUFFERS;
+uint16_t AudioControlI2S::buffer_length = AUDIO_BLOCK_SAMPLES;
+uint8_t AudioControlI2S::dma_buffers = 0;		// the files have none
+uint16_t AudioControlI2S::dma_length = AUDIO_BLOCK_SAMPLES;
+// files never glitch
+bool AudioControlI2S::resync = false;
+uint32_t AudioControlI2S::underruns = 0;
+uint32_t AudioControlI2S::underrunTime = 0;
+uint32_t AudioControlI2S::overruns = 0;
+uint32_t AudioControlI2S::overrunTime = 0;
+
+AudioControlI2S::~AudioControlI2S() { }
+
+// The files stand in for a codec that has been set up
+struct HostControl : public AudioControlI2S {
+	static void configure(void) { configured = true; }
+};
+
+// Any codec setup just lets the I2S objects run on the files
+void AudioControlI2S::start(i2s_port_t i2s_port, i2s_config_t* i2s_config, i2s_pin_config_t* i2s_pin_config, bool outputMCLK)
+{
+	configured = true;
+}
+
+// Kept for a build for the device; the files have no DMA buffers
+bool AudioControlI2S::buffers(unsigned int count, unsigned int length)
+{
+	if (!valid_buffers(count, length)) return false;
+	buffer_count = count;
+	buffer_length = length;
+	return true;
+}
+
+void AudioControlI2S::default_codec_rx_tx_24bit() { configured = true; }
+void AudioControlI2S::default_adc_dac() { configured = true; }
+void AudioControlI2S::ac101() { configured = true; }
+
+bool AudioHostWav::input(const char *path)
+{
+	if (input_open) drwav_uninit(&input_wav);
+	input_open = drwav_init_file(&input_wav, path);
+	input_done = false;
+	inputFrames = 0;
+	if (!input_open) {
+		ESP_LOGE(TAG, "can't read %s", path);
+		return false;
+	}
+	if (input_wav.sampleRate != AudioContext::global().sample_rate) {
+		AudioContext::global().set_sample_rate(input_wav.sampleRate);
+	}
+	HostControl::configure();
+	return true;
+}
+
+bool AudioHostWav::output(const char *path)
+{
+	drwav_data_format format;
+
+	if (output_open) drwav_uninit(&output_wav);
+	format.container = drwav_container_riff;
+	format.format = DR_WAVE_FORMAT_IEEE_FLOAT;
+	format.channels = 2;
+	format.sampleRate = (drwav_uint32)AudioContext::global().sample_rate;
+	format.bitsPerSample = 32;
+	output_open = drwav_init_file_write(&output_wav, path, &format);
+	outputFrames = 0;
+	if (!output_open) {
+		ESP_LOGE(TAG, "can't write %s", path);
+		return false;
+	}
+	HostControl::configure();
+	return true;
+}
+
+bool AudioHostWav::finished(void)
+{
+	return input_done;
+}
+
+void AudioHostWav::close(void)
+{
+	if (input_open) drwav_uninit(&input_wav);
+	if (output_open) drwav_uninit(&output_wav);
+	input_open = output_open = false;
+}
+
+// The next block of the input file, as frames of 1 or 2 channels.
+// False once the file has run out.
+static bool read_block(float *frames, unsigned int &channels)
+{
+	unsigned int n = 0;
+
+	if (!input_open || input_done) return false;
+	channels = input_wav.channels;
+	if (channels <= 2) {
+		n = (unsigned int)drwav_read_f32(&input_wav, AUDIO_BLOCK_SAMPLES * channels, frames) / channels;
+	} else {
+		// only the first two channels of wider files
+		float frame[16];
+		while (n < AUDIO_BLOCK_SAMPLES && channels <= 16 &&
+				drwav_read_f32(&input_wav, channels, frame) == channels) {
+			frames[n * 2] = frame[0];
+			frames[n * 2 + 1] = frame[1];
+			n++;
+		}
+		channels = 2;
+	}
+	AudioHostWav::inputFrames += n;
+	if (n < AUDIO_BLOCK_SAMPLES) {
+		input_done = true;
+		audio_fill(frames + n * channels, 0.0f, (AUDIO_BLOCK_SAMPLES - n) * channels);
+	}
+	return true;
+}
+
+// Splits frames into the blocks, and returns whether each channel has
+// any non-zero sample
+static void split_block(const float *frames, unsigned int channels, audio_block_t *new_left,
+	audio_block_t *new_right, uint32_t &left_bits, uint32_t &right_bits)
+{
+	left_bits = right_bits = 0;
+	for (unsigned int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+		float left = frames[i * channels];
+		float right = frames[i * channels + channels - 1];
+		if (new_left) new_left->data[i] = left;
+		if (new_right) new_right->data[i] = right;
+		left_bits |= (left != 0.0f);
+		right_bits |= (right != 0.0f);
+	}
+}
+
+// A block to the output file; a NULL block is silence
+static void write_block(const audio_block_t *block_left, const audio_block_t *block_right)
+{
+	float frames[AUDIO_BLOCK_SAMPLES * 2];
+
+	if (!output_open) return;
+	for (unsigned int i = 0; i < AUDIO_BLOCK_SAMPLES; i++) {
+		frames[i * 2] = block_left ? block_left->data[i] : 0.0f;
+		frames[i * 2 + 1] = block_right ? block_right->data[i] : 0.0f;
+	}
+	AudioHostWav::outputFrames += drwav_write(&output_wav, AUDIO_BLOCK_SAMPLES * 2, frames) / 2;
+}
+
+void AudioInputI2S::update(void)
+{
+	float frames[AUDIO_BLOCK_SAMPLES * 2];
+	audio_block_t *new_left, *new_right;
+	unsigned int channels;
+	uint32_t left_bits, right_bits;
+
+	if (!read_block(frames, channels)) return;
+	new_left = allocate();
+	new_right = allocate();
+	split_block(frames, channels, new_left, new_right, left_bits, right_bits);
+	// digital silence goes out as no block at all, as from the codec
+	if (new_left) {
+		if (left_bits) transmit(new_left, 0);
+		release(new_left);
+	}
+	if (new_right) {
+		if (right_bits) transmit(new_right, 1);
+		release(new_right);
+	}
+}
+
+void AudioOutputI2S::update(void)
+{
+	audio_block_t *block_left, *block_right;
+
+	block_left = receiveReadOnly(0);  // input 0
+	block_right = receiveReadOnly(1); // input 1
+	write_block(block_left, block_right);
+	if (block_left) release(block_left);
+	if (block_right) release(block_right);
+}
+
+// The files have no DMA buffers: the output lags the input by the
+// block through the graph
+void AudioIOI2S::update(void)
+{
+	float frames[AUDIO_BLOCK_SAMPLES * 2];
+	audio_block_t *block_left, *block_right, *new_left, *new_right;
+	unsigned int channels;
+	uint32_t left_bits, right_bits;
+
+	block_left = receiveReadOnly(0);
+	block_right = receiveReadOnly(1);
+	write_block(block_left, block_right);
+	if (block_left) release(block_left);
+	if (block_right) release(block_right);
+
+	if (!read_block(frames, channels)) return;
+	new_left = allocate();
+	new_right = allocate();
+	split_block(frames, channels, new_left, new_right, left_bits, right_bits);
+	if (new_left) {
+		if (left_bits) transmit(new_left, 0);
+		release(new_left);
+	}
+	if (new_right) {
+		if (right_bits) transmit(new_right, 1);
+		release(new_right);
+	}
+}
+
+uint32_t AudioIOI2S::latencySamples(void)
+{
+	return AUDIO_BLOCK_SAMPLES + AudioControlI2S::latencySamples();
+}
@@ -0,0 +1,7 @@
+#ifndef host_sdmmc_cmd_h_
+#define host_sdmmc_cmd_h_
+
+// Host build: the codec and SD card objects are not built, their
+// headers only include this
+
+#endif
@@ -4,6 +4,7 @@
 // include all the library headers, so a sketch can use a single
 // #include <Audio.h> to get the whole library
 
+#include "analyze_tap.h"
 #include "control_afs22.h"
 #include "control_i2s.h"
 #include "control_pcm3060.h"
@@ -15,11 +16,13 @@
 #include "effect_envelope.h"
 #include "effect_multiply.h"
 #include "input_i2s.h"
+#include "io_i2s.h"
 #include "mixer.h"
 #include "output_i2s.h"
 #include "play_sdmmc_wav.h"
 #include "record_psram.h"
 #include "synth_dc.h"
 #include "synth_sine.h"
+#include "synth_control.h"
 
 //#endif
\ No newline at end of file
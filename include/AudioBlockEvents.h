@@ -0,0 +1,52 @@
+#ifndef AudioBlockEvents_h
+#define AudioBlockEvents_h
+
+#include <inttypes.h>
+#include "AudioStream.h"
+
+// Most changes an object keeps for one block
+#ifndef AUDIO_BLOCK_EVENTS
+#define AUDIO_BLOCK_EVENTS 4
+#endif
+
+// Parameter changes timed for a sample inside the coming block, kept by
+// an object from command() until its update() reaches them.  update()
+// processes the samples up to next(), passes pop() back to command()
+// with offset 0, and so on to the end of the block.
+class AudioBlockEvents
+{
+public:
+	struct event {
+		uint16_t offset;
+		uint8_t id;
+		float value[3];
+	};
+	AudioBlockEvents() : count(0), first(0) { }
+	// false when full, then the change is made at once
+	bool add(uint8_t id, const float *value, unsigned int offset) {
+		if (count == AUDIO_BLOCK_EVENTS) return false;
+		event &e = list[count++];
+		e.offset = offset;
+		e.id = id;
+		e.value[0] = value[0];
+		e.value[1] = value[1];
+		e.value[2] = value[2];
+		return true;
+	}
+	bool empty(void) const { return first == count; }
+	// the sample of the next change, AUDIO_BLOCK_SAMPLES when there is none
+	unsigned int next(void) const {
+		return (first < count) ? list[first].offset : AUDIO_BLOCK_SAMPLES;
+	}
+	const event &pop(void) {
+		const event &e = list[first++];
+		if (first == count) first = count = 0;
+		return e;
+	}
+private:
+	event list[AUDIO_BLOCK_EVENTS];
+	uint8_t count;
+	uint8_t first;
+};
+
+#endif
@@ -0,0 +1,288 @@
+#ifndef AudioKernels_h_
+#define AudioKernels_h_
+
+#include "AudioStream.h"
+#include <string.h>
+
+// The loops over blocks that many objects share.  They work on any
+// number of samples from any float, and dst may be the same as src for
+// all but copy.  Each takes 4 samples a step, loading them all before
+// storing any: the compiler then packs a step into one SSE operation
+// on a PC, and on the ESP32 the loads run ahead of the FPU.
+//
+// On the ESP32 the kernels that esp-dsp has (scale, add, multiply and
+// the biquad) go to its assembly instead, for aligned data.  Build with
+// -DAUDIO_USE_ESP_DSP=0 to use the C everywhere.  The C does the same
+// operations in the same order as esp-dsp's reference C, so a graph
+// gives the same samples on a PC as on the device with esp-dsp off.
+#ifndef AUDIO_USE_ESP_DSP
+#if defined(ESP_PLATFORM) && __has_include("esp_dsp.h")
+#define AUDIO_USE_ESP_DSP 1
+#else
+#define AUDIO_USE_ESP_DSP 0
+#endif
+#endif
+
+#if AUDIO_USE_ESP_DSP
+#include "esp_dsp.h"
+
+// esp-dsp's assembly for the ESP32-S3 wants 16-byte aligned vectors
+static inline bool audio_dsp_aligned(const void *a, const void *b)
+{
+	return (((uintptr_t)a | (uintptr_t)b) & (AUDIO_BLOCK_ALIGN - 1)) == 0;
+}
+#endif
+
+static inline void audio_copy(float *dst, const float *src, unsigned int n = AUDIO_BLOCK_SAMPLES)
+{
+	memcpy(dst, src, n * sizeof(float));
+}
+
+static inline void audio_fill(float *dst, float value, unsigned int n = AUDIO_BLOCK_SAMPLES)
+{
+	unsigned int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		dst[i] = value;
+		dst[i+1] = value;
+		dst[i+2] = value;
+		dst[i+3] = value;
+	}
+	for (; i < n; i++) dst[i] = value;
+}
+
+// dst = src * gain
+static inline void audio_scale(float *dst, const float *src, float gain, unsigned int n = AUDIO_BLOCK_SAMPLES)
+{
+#if AUDIO_USE_ESP_DSP
+	if (audio_dsp_aligned(dst, src)) {
+		dsps_mulc_f32(src, dst, n, gain, 1, 1);
+		return;
+	}
+#endif
+	unsigned int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		float a = src[i], b = src[i+1], c = src[i+2], d = src[i+3];
+		dst[i] = a * gain;
+		dst[i+1] = b * gain;
+		dst[i+2] = c * gain;
+		dst[i+3] = d * gain;
+	}
+	for (; i < n; i++) dst[i] = src[i] * gain;
+}
+
+// dst = src * scale + offset
+static inline void audio_affine(float *dst, const float *src, float scale, float offset, unsigned int n = AUDIO_BLOCK_SAMPLES)
+{
+	unsigned int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		float a = src[i], b = src[i+1], c = src[i+2], d = src[i+3];
+		dst[i] = a * scale + offset;
+		dst[i+1] = b * scale + offset;
+		dst[i+2] = c * scale + offset;
+		dst[i+3] = d * scale + offset;
+	}
+	for (; i < n; i++) dst[i] = src[i] * scale + offset;
+}
+
+// dst += src
+static inline void audio_add(float *dst, const float *src, unsigned int n = AUDIO_BLOCK_SAMPLES)
+{
+#if AUDIO_USE_ESP_DSP
+	if (audio_dsp_aligned(dst, src)) {
+		dsps_add_f32(dst, src, dst, n, 1, 1, 1);
+		return;
+	}
+#endif
+	unsigned int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		float a = src[i], b = src[i+1], c = src[i+2], d = src[i+3];
+		dst[i] += a;
+		dst[i+1] += b;
+		dst[i+2] += c;
+		dst[i+3] += d;
+	}
+	for (; i < n; i++) dst[i] += src[i];
+}
+
+// dst += src * gain
+static inline void audio_scale_add(float *dst, const float *src, float gain, unsigned int n = AUDIO_BLOCK_SAMPLES)
+{
+	unsigned int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		float a = src[i], b = src[i+1], c = src[i+2], d = src[i+3];
+		dst[i] += a * gain;
+		dst[i+1] += b * gain;
+		dst[i+2] += c * gain;
+		dst[i+3] += d * gain;
+	}
+	for (; i < n; i++) dst[i] += src[i] * gain;
+}
+
+// dst = src * a gain moving in a straight line: start + step for the
+// first sample, start + n * step for the last
+static inline void audio_scale_line(float *dst, const float *src, float start, float step, unsigned int n = AUDIO_BLOCK_SAMPLES)
+{
+	unsigned int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		float g = start + (float)i * step;
+		float a = src[i], b = src[i+1], c = src[i+2], d = src[i+3];
+		dst[i] = a * (g + step);
+		dst[i+1] = b * (g + 2.0f * step);
+		dst[i+2] = c * (g + 3.0f * step);
+		dst[i+3] = d * (g + 4.0f * step);
+	}
+	for (; i < n; i++) dst[i] = src[i] * (start + (float)(i + 1) * step);
+}
+
+// dst += src * the same line
+static inline void audio_scale_add_line(float *dst, const float *src, float start, float step, unsigned int n = AUDIO_BLOCK_SAMPLES)
+{
+	unsigned int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		float g = start + (float)i * step;
+		float a = src[i], b = src[i+1], c = src[i+2], d = src[i+3];
+		dst[i] += a * (g + step);
+		dst[i+1] += b * (g + 2.0f * step);
+		dst[i+2] += c * (g + 3.0f * step);
+		dst[i+3] += d * (g + 4.0f * step);
+	}
+	for (; i < n; i++) dst[i] += src[i] * (start + (float)(i + 1) * step);
+}
+
+// dst = a * b
+static inline void audio_multiply(float *dst, const float *a, const float *b, unsigned int n = AUDIO_BLOCK_SAMPLES)
+{
+#if AUDIO_USE_ESP_DSP
+	if (audio_dsp_aligned(dst, a) && audio_dsp_aligned(b, b)) {
+		dsps_mul_f32(a, b, dst, n, 1, 1, 1);
+		return;
+	}
+#endif
+	unsigned int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		float a0 = a[i], a1 = a[i+1], a2 = a[i+2], a3 = a[i+3];
+		float b0 = b[i], b1 = b[i+1], b2 = b[i+2], b3 = b[i+3];
+		dst[i] = a0 * b0;
+		dst[i+1] = a1 * b1;
+		dst[i+2] = a2 * b2;
+		dst[i+3] = a3 * b3;
+	}
+	for (; i < n; i++) dst[i] = a[i] * b[i];
+}
+
+// dst = src limited to lo .. hi
+static inline void audio_clamp(float *dst, const float *src, float lo, float hi, unsigned int n = AUDIO_BLOCK_SAMPLES)
+{
+	unsigned int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		float a = src[i], b = src[i+1], c = src[i+2], d = src[i+3];
+		dst[i] = a < lo ? lo : (a > hi ? hi : a);
+		dst[i+1] = b < lo ? lo : (b > hi ? hi : b);
+		dst[i+2] = c < lo ? lo : (c > hi ? hi : c);
+		dst[i+3] = d < lo ? lo : (d > hi ? hi : d);
+	}
+	for (; i < n; i++) dst[i] = src[i] < lo ? lo : (src[i] > hi ? hi : src[i]);
+}
+
+// the sum of src, in 4 partial sums
+static inline float audio_sum(const float *src, unsigned int n = AUDIO_BLOCK_SAMPLES)
+{
+	float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+	unsigned int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		s0 += src[i];
+		s1 += src[i+1];
+		s2 += src[i+2];
+		s3 += src[i+3];
+	}
+	for (; i < n; i++) s0 += src[i];
+	return (s0 + s1) + (s2 + s3);
+}
+
+// PCM samples of up to 32 bits sit in the top bits of an int32_t, and
+// come every stride int32_t in dst or src (2 for one channel of
+// interleaved stereo).  From PCM, dst = sample * scale, and the OR of
+// all the samples comes back: 0 for digital silence.
+static inline uint32_t audio_from_pcm(float *dst, const int32_t *src, unsigned int stride, unsigned int bits, float scale, unsigned int n = AUDIO_BLOCK_SAMPLES)
+{
+	const unsigned int shift = 32 - bits;
+	uint32_t any = 0;
+	unsigned int i = 0;
+	for (; i + 4 <= n; i += 4, src += 4 * stride) {
+		int32_t a = src[0] >> shift, b = src[stride] >> shift;
+		int32_t c = src[2 * stride] >> shift, d = src[3 * stride] >> shift;
+		any |= (uint32_t)(a | b | c | d);
+		dst[i] = (float)a * scale;
+		dst[i+1] = (float)b * scale;
+		dst[i+2] = (float)c * scale;
+		dst[i+3] = (float)d * scale;
+	}
+	for (; i < n; i++, src += stride) {
+		int32_t a = *src >> shift;
+		any |= (uint32_t)a;
+		dst[i] = (float)a * scale;
+	}
+	return any;
+}
+
+// The largest float below 2^(bits - 1), the top of a PCM sample
+static inline float audio_pcm_max(unsigned int bits)
+{
+	return bits > 24 ? (float)(1u << (bits - 1)) - (float)(1u << (bits - 25)) : (float)((1u << (bits - 1)) - 1);
+}
+
+// To PCM: src * scale, rounded toward zero and saturated to bits bits
+// rather than wrapping on overs.  A NaN fails both tests of the clamp
+// and comes out as the bottom of the range.  A NULL src gives silence.
+static inline void audio_to_pcm(int32_t *dst, unsigned int stride, const float *src, unsigned int bits, float scale, unsigned int n = AUDIO_BLOCK_SAMPLES)
+{
+	const unsigned int shift = 32 - bits;
+	const float hi = audio_pcm_max(bits), lo = -(float)(1u << (bits - 1));
+	unsigned int i = 0;
+	if (!src) {
+		for (; i < n; i++, dst += stride) *dst = 0;
+		return;
+	}
+	for (; i + 4 <= n; i += 4, dst += 4 * stride) {
+		float a = src[i] * scale, b = src[i+1] * scale, c = src[i+2] * scale, d = src[i+3] * scale;
+		a = a > lo ? a : lo;  a = a < hi ? a : hi;
+		b = b > lo ? b : lo;  b = b < hi ? b : hi;
+		c = c > lo ? c : lo;  c = c < hi ? c : hi;
+		d = d > lo ? d : lo;  d = d < hi ? d : hi;
+		dst[0] = (int32_t)((uint32_t)(int32_t)a << shift);
+		dst[stride] = (int32_t)((uint32_t)(int32_t)b << shift);
+		dst[2 * stride] = (int32_t)((uint32_t)(int32_t)c << shift);
+		dst[3 * stride] = (int32_t)((uint32_t)(int32_t)d << shift);
+	}
+	for (; i < n; i++, dst += stride) {
+		float a = src[i] * scale;
+		a = a > lo ? a : lo;  a = a < hi ? a : hi;
+		*dst = (int32_t)((uint32_t)(int32_t)a << shift);
+	}
+}
+
+// A biquad in direct form II, as esp-dsp's dsps_biquad_f32: coef is
+// b0, b1, b2, a1, a2 (a0 being 1), and w the two delay elements, kept
+// from one block to the next.  The samples depend on each other, so
+// this one goes one at a time.
+static inline void audio_biquad(float *dst, const float *src, const float *coef, float *w, unsigned int n = AUDIO_BLOCK_SAMPLES)
+{
+#if AUDIO_USE_ESP_DSP
+	if (audio_dsp_aligned(dst, src)) {
+		dsps_biquad_f32(src, dst, n, (float *)coef, w);
+		return;
+	}
+#endif
+	float b0 = coef[0], b1 = coef[1], b2 = coef[2], a1 = coef[3], a2 = coef[4];
+	float w0 = w[0], w1 = w[1];
+	for (unsigned int i = 0; i < n; i++) {
+		float d0 = src[i] - a1 * w0 - a2 * w1;
+		dst[i] = b0 * d0 + b1 * w0 + b2 * w1;
+		w1 = w0;
+		w0 = d0;
+	}
+	w[0] = w0;
+	w[1] = w1;
+}
+
+#endif
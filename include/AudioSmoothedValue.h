@@ -0,0 +1,80 @@
+#ifndef AudioSmoothedValue_h
+#define AudioSmoothedValue_h
+
+#include <inttypes.h>
+#include <math.h>
+
+// Time a parameter takes to reach a new value, unless the object is
+// told otherwise
+#ifndef AUDIO_SMOOTHING_MS
+#define AUDIO_SMOOTHING_MS 5.0f
+#endif
+
+// A parameter that moves to a new value sample by sample, so gain, delay
+// time and cutoff changes don't click.  LINEAR moves by equal steps, for
+// gains; EXPONENTIAL by equal ratios, for frequencies (values above 0).
+class AudioSmoothedValue
+{
+public:
+	enum { LINEAR, EXPONENTIAL };
+	AudioSmoothedValue(float initial = 0.0f, uint8_t curve = LINEAR) :
+		current(initial), goal(initial), step(0.0f), remaining(0), length(0), ms(0.0f), shape(curve) { }
+	// how long a change takes; 0 jumps at once
+	void time(float milliseconds, float sample_rate) {
+		ms = milliseconds;
+		rate(sample_rate);
+	}
+	// keep the time in milliseconds at a new sample rate
+	void rate(float sample_rate) {
+		length = (ms > 0.0f) ? (uint32_t)(ms * sample_rate / 1000.0f + 0.5f) : 0;
+	}
+	void set(float value) {
+		goal = value;
+		if (length == 0 || value == current) {
+			jump(value);
+			return;
+		}
+		linear = !(shape == EXPONENTIAL && value > 0.0f && current > 0.0f);
+		step = linear ? (value - current) / length : powf(value / current, 1.0f / length);
+		remaining = length;
+	}
+	void jump(float value) {
+		current = goal = value;
+		remaining = 0;
+	}
+	bool ramping(void) const { return remaining != 0; }
+	float value(void) const { return current; }
+	float target(void) const { return goal; }
+	// the value for the next sample
+	float next(void) {
+		if (remaining == 0) return current;
+		if (--remaining == 0) {
+			current = goal;
+		} else if (linear) {
+			current += step;
+		} else {
+			current *= step;
+		}
+		return current;
+	}
+	// move on by a number of samples, eg. a block without input
+	void skip(uint32_t samples) {
+		if (samples >= remaining) {
+			jump(goal);
+		} else {
+			current = linear ? current + step * samples : current * powf(step, (float)samples);
+			remaining -= samples;
+		}
+	}
+private:
+	float current;
+	float goal;
+	float step;				// added or multiplied per sample
+	uint32_t remaining;		// samples until goal
+	uint32_t length;		// samples a change takes
+	float ms;
+	uint8_t shape;
+	bool linear = true;		// this ramp adds step, else multiplies
+};
+
+#endif
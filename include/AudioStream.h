@@ -35,23 +35,83 @@
 #include <string.h> // for memcpy
 #include <inttypes.h>
 
+// The block size can be set for the whole library with a build flag,
+// eg. -DAUDIO_BLOCK_SAMPLES=32 in platformio.ini.  Kernels process
+// samples in groups of 8, and the I2S DMA buffers hold 1 block.
+#ifndef AUDIO_BLOCK_SAMPLES
 #define AUDIO_BLOCK_SAMPLES  128
+#endif
+#if AUDIO_BLOCK_SAMPLES < 16 || AUDIO_BLOCK_SAMPLES > 512 || (AUDIO_BLOCK_SAMPLES % 8) != 0
+#error "AUDIO_BLOCK_SAMPLES must be a multiple of 8, from 16 to 512"
+#endif
+// The sample rate a graph starts with.  AudioSampleRate() changes
+// it at runtime, for all objects; read it from their sample_rate.
 #define AUDIO_SAMPLE_RATE_EXACT 44100
 #define AUDIO_SAMPLE_RATE AUDIO_SAMPLE_RATE_EXACT
 
+// Most blocks one pool can hold, and the words of its free mask
+#define MAX_AUDIO_MEMORY 163840
+#define AUDIO_MEMORY_MASKS (((MAX_AUDIO_MEMORY / AUDIO_BLOCK_SAMPLES / 2) + 31) / 32)
+// The same for the second tier of blocks, in PSRAM
+#ifndef AUDIO_MEMORY_PSRAM_MAX
+#define AUDIO_MEMORY_PSRAM_MAX 2048
+#endif
+#define AUDIO_MEMORY_PSRAM_MASKS ((AUDIO_MEMORY_PSRAM_MAX + 31) / 32)
+
+// Most graph changes (connections, new or deleted objects) waiting
+// for the next block boundary, and in one patch
+#ifndef AUDIO_PATCH_QUEUE
+#define AUDIO_PATCH_QUEUE 64
+#endif
+// Most parameter changes waiting for the next block boundary
+#ifndef AUDIO_COMMAND_QUEUE
+#define AUDIO_COMMAND_QUEUE 64
+#endif
+
+// Build with -DAUDIO_TRACE=1 to record when every update ran and a
+// histogram of its clocks, for AudioTrace.h.  Without it nothing is
+// recorded and nothing is added to the objects.
+#ifndef AUDIO_TRACE
+#define AUDIO_TRACE 0
+#endif
+#ifndef AUDIO_TRACE_EVENTS
+#define AUDIO_TRACE_EVENTS 512			// updates kept in the trace
+#endif
+#define AUDIO_TRACE_BUCKETS 24			// histogram buckets, clocks from 2^n to 2^(n+1)
+
 class AudioStream;
 class AudioConnection;
+class AudioContext;
+
+// Sample data starts on this boundary, for loads of 4 floats at once
+#define AUDIO_BLOCK_ALIGN 16
 
 typedef struct audio_block_struct {
-	uint8_t  ref_count;
-	uint8_t  reserved1;
+	uint32_t ref_count;		// only changed with atomic operations
 	uint16_t memory_pool_index;
-    float    data[AUDIO_BLOCK_SAMPLES];
-	//int      blockLength = AUDIO_BLOCK_SAMPLES; // AUDIO_BLOCK_SAMPLES is 128, from AudioStream.h
+	uint16_t memory_pool_tier;	// the pool it came from, AudioContext::MEMORY_*
+    float    data[AUDIO_BLOCK_SAMPLES] __attribute__((aligned(AUDIO_BLOCK_ALIGN)));
+	//int      blockLength = AUDIO_BLOCK_SAMPLES; // AUDIO_BLOCK_SAMPLES is 128 by default, from AudioStream.h
     //float    sampleRate = AUDIO_SAMPLE_RATE; // AUDIO_SAMPLE_RATE is 44117.64706 from AudioStream.h
 	//int 	 byteLength = AUDIO_BLOCK_SAMPLES * sizeof(float);
 } audio_block_t;
 
+// The first aligned block in memory from malloc(), which only promises
+// 4 or 8 bytes: allocate AUDIO_BLOCK_ALIGN bytes more than the blocks
+static inline audio_block_t * audio_block_align(void *raw)
+{
+	return (audio_block_t *)(((uintptr_t)raw + AUDIO_BLOCK_ALIGN - 1) & ~(uintptr_t)(AUDIO_BLOCK_ALIGN - 1));
+}
+
+// A control-rate value on an AudioControlConnection: one per block, as a
+// ramp from the value sent for the last block to the one for this block
+typedef struct audio_control_struct {
+	float start;			// at the first sample of the block
+	float end;				// at the last sample
+	bool fresh;				// sent for this block
+	bool started;			// sent before, so start follows on from it
+} audio_control_t;
+
 
 class AudioConnection
 {
@@ -60,6 +120,7 @@ public:
 		src(source), dst(destination), src_index(0), dest_index(0),
 		next_dest(NULL)
 		{ isConnected = false;
+		  fade = FADE_NONE;
 		  connect(); }
 	AudioConnection(AudioStream &source, unsigned char sourceOutput,
 		AudioStream &destination, unsigned char destinationInput) :
@@ -67,36 +128,240 @@ public:
 		src_index(sourceOutput), dest_index(destinationInput),
 		next_dest(NULL)
 		{ isConnected = false;
+		  fade = FADE_NONE;
 		  connect(); }
 	friend class AudioStream;
-	~AudioConnection() {
-		disconnect();
-	}
+	friend class AudioContext;
+	~AudioConnection();
+	// While update_all runs on another task, these take effect at the
+	// next block boundary, fading the connection in or out over 1 block
 	void disconnect(void);
 	void connect(void);
+	// true when the destination runs before the source in update_all,
+	// so data on this connection arrives one block later
+	bool isFeedback(void) { return feedback; }
 protected:
+	enum control_tag { CONTROL };
+	AudioConnection(AudioStream &source, AudioStream &destination,
+		unsigned char destinationControl, control_tag) :
+		src(source), dst(destination), src_index(0), dest_index(destinationControl),
+		next_dest(NULL)
+		{ isConnected = false;
+		  fade = FADE_NONE;
+		  control = true;
+		  connect(); }
 	AudioStream &src;
 	AudioStream &dst;
 	unsigned char src_index;
-	unsigned char dest_index;
+	unsigned char dest_index;		// the control input, for control connections
 	AudioConnection *next_dest;
 	bool isConnected;
+	bool feedback = false;
+	bool control = false;			// carries one value per block, not audio
+private:
+	void link(void);
+	void unlink(void);
+	enum { FADE_NONE, FADE_IN, FADE_OUT };
+	uint8_t fade;					// ramp for the block in progress
+	AudioConnection *next_fade;		// list of connections fading
 };
 
 
+// Connects a control-rate source (eg. AudioSynthControlLFO) to a control
+// input of another object, eg. the gain of an amp.  It orders the update
+// like an audio connection, but carries one value per block instead of
+// a block of samples.
+class AudioControlConnection : public AudioConnection
+{
+public:
+	AudioControlConnection(AudioStream &source, AudioStream &destination,
+		unsigned char destinationControl = 0) :
+		AudioConnection(source, destination, destinationControl, CONTROL) { }
+};
+
+
+// A graph of audio objects, with its own pool of blocks and its own
+// update_all.  Objects join the context that is current when they are
+// created, normally the global one that AudioMemory() and the static
+// AudioStream functions use.  Several contexts can run side by side,
+// eg. one per core, or many graphs rendered offline in one program.
+class AudioContext
+{
+public:
+	AudioContext(void);
+	~AudioContext();
+	static AudioContext &global(void);	// the default context
+	static AudioContext &current(void);	// the context new objects join
+	void select(void) { current_context = this; }
+	// Blocks come from two tiers: internal RAM, fast for the blocks that
+	// pass through the graph every update, and PSRAM, large but slower,
+	// for blocks that objects keep for a long time, like delay lines
+	enum { MEMORY_INTERNAL, MEMORY_PSRAM, MEMORY_TIERS };
+	void initialize_memory(audio_block_t *data, unsigned int num, uint8_t tier = MEMORY_INTERNAL);
+	// A block from the given tier, or from the other one when it is empty
+	audio_block_t * allocate(uint8_t tier = MEMORY_INTERNAL);
+	// A block from the given tier only
+	audio_block_t * allocate_in(uint8_t tier);
+	void release(audio_block_t * block);
+	bool initialize_planned_memory(unsigned int spare = 0);
+	void update_all(void);
+	void update_order(void);
+	void set_sample_rate(float rate);
+	bool enable_parallel_update(int core = 0, unsigned int priority = 24);
+	// Group graph changes made from another task, so they all take effect
+	// at the same block boundary, eg. to swap one effect chain for another
+	void begin_patch(void) { patch_open = true; }
+	void commit_patch(void);
+	// Samples rendered so far, the time of the first sample of the next block
+	uint32_t sample_time(void) { return __atomic_load_n(&sample_clock, __ATOMIC_ACQUIRE); }
+	// Parameter changes made from another task after at() take effect at
+	// that sample time, inside its block on objects that split their
+	// processing there (envelope, amp, waveform frequency), at the start
+	// of it on the others.  Times must not go backwards; at_next_block()
+	// goes back to applying changes at the next block boundary.
+	void at(uint32_t time) { post_time = time; post_timed = true; }
+	void at_next_block(void) { post_timed = false; }
+	uint32_t memory_used;
+	uint32_t memory_used_max;
+	uint32_t memory_size;			// blocks in the pool, both tiers
+	uint32_t memory_tier_used[MEMORY_TIERS];
+	uint32_t memory_tier_used_max[MEMORY_TIERS];
+	uint32_t memory_tier_size[MEMORY_TIERS];
+	uint32_t memory_needed;			// most blocks the graph uses at once, from its update order
+	uint32_t clocksOverhead;		//Clocks of the last update_all, not spent in updates
+	uint32_t clocksOverheadMax;
+	// Deadline monitor: the clocks of processing in the last block (on the
+	// busiest core, with the overhead), against what one block may take
+	uint32_t blockClocks;
+	uint32_t blockClocksMax;
+	uint32_t deadlineClocks;
+	uint32_t overruns;				// blocks that went over deadlineClocks
+	void set_deadline(float fraction);	// of the block period, 0.9 by default
+	// Called after every block on the audio task, with overrun true when
+	// the block went over the deadline.  It may change degradeLevel with
+	// set_degrade_level().  NULL, the default, only counts overruns.
+	typedef void (*degrade_policy)(AudioContext &context, bool overrun);
+	void set_degrade_policy(degrade_policy policy) { degrade = policy; }
+	// A policy that takes objects marked optional one level down on each
+	// overrun, and one level back up after a second of blocks well under
+	// the deadline
+	static void degrade_optional(AudioContext &context, bool overrun);
+	// Sets every optional object to AudioStream::DEGRADE_NONE, _QUALITY or _BYPASS
+	void set_degrade_level(uint8_t level);
+	uint8_t degradeLevel;
+#if AUDIO_TRACE
+	// The last AUDIO_TRACE_EVENTS updates, oldest first from trace_count.
+	// Stamps are xthal_get_ccount() of the core that ran them.
+	struct trace_event {
+		const char *name;			// NULL for update_all itself
+		uint32_t start;
+		uint32_t stop;
+		int8_t core;
+	};
+	trace_event trace_events[AUDIO_TRACE_EVENTS];
+	uint32_t trace_count;			// events recorded since the start
+	bool trace_on;					// recording
+	bool trace_stop_on_overrun;		// stop recording after the first overrun, to keep it
+	void trace(const char *name, uint32_t start, uint32_t stop, int8_t core) {
+		uint32_t i = __atomic_fetch_add(&trace_count, 1, __ATOMIC_RELAXED) % AUDIO_TRACE_EVENTS;
+		trace_events[i].name = name;
+		trace_events[i].start = start;
+		trace_events[i].stop = stop;
+		trace_events[i].core = core;
+	}
+#endif
+	float sample_rate;
+	AudioStream *first_update;		// for update_all, in data flow order
+	bool blockingObjectRunning;		// an object in this graph throttles update_all
+private:
+	friend class AudioStream;
+	friend class AudioConnection;
+	static AudioContext *current_context;
+	void add(AudioStream *stream);
+	void remove(AudioStream *stream);
+	void add_now(AudioStream *stream);
+	void remove_now(AudioStream *stream);
+	bool update_loop_start(AudioStream *stream);
+	enum { PATCH_CONNECT, PATCH_DISCONNECT, PATCH_ADD, PATCH_REMOVE };
+	struct patch_op {
+		uint8_t type;
+		void *target;
+	};
+	patch_op patch_queue[AUDIO_PATCH_QUEUE];
+	uint32_t patch_head;			// written by the patching task
+	uint32_t patch_committed;		// ready for the audio task
+	uint32_t patch_applied;			// done by the audio task
+	bool patch_open;
+	AudioConnection *first_fade;
+	bool audio_task_elsewhere(void);
+	uint32_t patch(uint8_t type, void *target);
+	void patch_wait(uint32_t seq);
+	void patch_apply(void);
+	struct command_op {
+		AudioStream *target;
+		uint8_t id;
+		bool timed;
+		uint32_t time;
+		float value[3];
+	};
+	command_op command_queue[AUDIO_COMMAND_QUEUE];
+	uint32_t command_head;			// written by the control task
+	uint32_t command_tail;			// read by the audio task
+	uint32_t post_time;				// at(), for the control task
+	bool post_timed;
+	uint32_t sample_clock;			// first sample of the block update_all renders next
+	bool post(AudioStream *target, uint8_t id, float a, float b, float c);
+	void command_apply(void);
+	AudioStream *first_stream;		// all streams, in order of creation
+	bool update_order_dirty;		// connections changed since update_order()
+	int update_caller_core;
+	int update_worker_core;
+	bool update_split;				// update_all runs the branches on 2 cores
+	void *update_caller_task;
+	void *update_worker_task;
+	void update_partition(void);
+	void update_fusion(void);
+	void plan_memory(void);
+	void update_stage_on(uint8_t stage, int core);
+	static void update_worker(void *parameter);
+	int updates_per_second;
+	int update_per_second_counter;
+	bool update_second_elapsed;
+	uint32_t update_stream_clocks[2];	//Clocks spent in update() per core, this update_all
+	uint32_t update_work_clocks[2];		//The same, without blocking streams
+	float deadline_fraction;
+	degrade_policy degrade;
+	uint32_t degrade_calm;				// blocks well under the deadline in a row
+	audio_block_t *memory_pool;
+	audio_block_t *memory_psram_pool;
+	void *memory_planned;			// the allocation of memory_pool, from initialize_planned_memory()
+	uint32_t memory_pool_available_mask[AUDIO_MEMORY_MASKS];
+	uint32_t memory_psram_available_mask[AUDIO_MEMORY_PSRAM_MASKS];
+	uint32_t memory_pool_first_mask[MEMORY_TIERS];
+};
+
 #define AudioMemory(num) ({ \
 	static audio_block_t data[num]; \
 	AudioStream::initialize_memory(data, num); \
 })
 
-/* #define AudioMemory(num) ({ \
-	static audio_block_t *data = (audio_block_t*)ps_malloc(num * sizeof(audio_block_t)); \
-	AudioStream::initialize_memory(data, num); \
-}) */
+// A second pool in PSRAM, for the blocks of delay lines and other
+// objects with memory_tier set to AudioContext::MEMORY_PSRAM.  Either
+// pool is used when the other runs out.
+#define AudioMemoryPSRAM(num) ({ \
+	void *raw = ps_malloc((num) * sizeof(audio_block_t) + AUDIO_BLOCK_ALIGN); \
+	if (raw) AudioContext::global().initialize_memory(audio_block_align(raw), num, AudioContext::MEMORY_PSRAM); \
+})
 
-#define AudioMemoryUsage() (AudioStream::memory_used)
-#define AudioMemoryUsageMax() (AudioStream::memory_used_max)
-#define AudioMemoryUsageMaxReset() (AudioStream::memory_used_max = AudioStream::memory_used)
+// Instead of guessing AudioMemory(num), size the pool from the graph,
+// in setup() after the connections are made
+#define AudioMemoryPlanned(spare) (AudioContext::global().initialize_planned_memory(spare))
+
+#define AudioSampleRate(rate) (AudioStream::set_sample_rate(rate))
+
+#define AudioMemoryUsage() (AudioContext::global().memory_used)
+#define AudioMemoryUsageMax() (AudioContext::global().memory_used_max)
+#define AudioMemoryUsageMaxReset() (AudioContext::global().memory_used_max = AudioContext::global().memory_used)
 
 class AudioStream
 {
@@ -105,58 +370,156 @@ public:
 		name(defaultName), num_inputs(ninput), inputQueue(iqueue) {
 			active = false;
 			blocking = false;
+			core = 0;
 			destination_list = NULL;
 			for (int i=0; i < num_inputs; i++) {
 				inputQueue[i] = NULL;
 			}
-			// add to a simple list, for update_all
-			// TODO: replace with a proper data flow analysis in update_all
-			if (first_update == NULL) {
-				first_update = this;
-			} else {
-				AudioStream *p;
-				for (p=first_update; p->next_update; p = p->next_update) ;
-				p->next_update = this;
-			}
-			next_update = NULL;
+			num_controls = 0;
+			controlQueue = NULL;
 			numConnections = 0;
+			next_update = NULL;
+			fuse_next = NULL;
+			fused = false;
+			sleeping = false;
+			silent_samples = 0;
+			optional = false;
+			degraded = DEGRADE_NONE;
+			memory_tier = AudioContext::MEMORY_INTERNAL;
+			ended = false;
+#if AUDIO_TRACE
+			memset(clocksHistogram, 0, sizeof(clocksHistogram));
+#endif
+			// add to the list of all streams of the context, in order
+			// of creation.  update_order() derives the update_all list from it.
+			context = &AudioContext::current();
+			context->add(this);
 		}
-	static void initialize_memory(audio_block_t *data, unsigned int num);
+	// Takes the object out of its graph, waiting for a running update_all
+	// to finish with it.  A subclass whose destructor frees anything that
+	// update() uses calls this first: ~AudioStream() comes too late, after
+	// the subclass is gone.
+	void end(void);
+	virtual ~AudioStream() { end(); }
+	// Move an object that has no connections yet to another context
+	bool setContext(AudioContext &ctx);
+	AudioContext *getContext(void) { return context; }
+	// These act on the global context
+	static void initialize_memory(audio_block_t *data, unsigned int num) { AudioContext::global().initialize_memory(data, num); }
+	static void update_all(void) { AudioContext::global().update_all(); }
+	static void update_order(void) { AudioContext::global().update_order(); }
+	static void set_sample_rate(float rate) { AudioContext::global().set_sample_rate(rate); }
+	static bool enable_parallel_update(int core = 0, unsigned int priority = 24) {
+		return AudioContext::global().enable_parallel_update(core, priority);
+	}
 	bool isActive(void) { return active; }
 	uint32_t clocksPerUpdate;
 	uint32_t clocksPerUpdateMax;
 	uint32_t clocksPerUpdateMin;
 	uint32_t clocksPerSecond;
-	static uint16_t memory_used;
-	static uint16_t memory_used_max;
-	static void update_all(void);
+	float sample_rate;		// of the context, kept up to date by set_sample_rate()
 
 	//The following 5 are public for CPU reporting
 	const char* name;
-	static AudioStream *first_update; // for update_all
-	AudioStream *next_update; // for update_all
+	AudioStream *next_update; // for update_all, in data flow order
 	bool active;			//If true; object has been connected to
 	bool blocking;			//If true; Ignore this object when calculating CPU clocks
 	bool initialised;		//If false: Ignore this object when calculating CPU clocks. Allows for lazy loaded classes that instantiate PSRAM or Flash.
-	static bool blockingObjectRunning;
+	int8_t core;			//The CPU core that runs this object's update
+	bool sleeping;			//If true; inputs are silent and the tail has ended, update() is skipped
+	// Objects marked optional may be degraded when blocks overrun their
+	// deadline: DEGRADE_QUALITY switches those that have one to a cheaper
+	// mode, DEGRADE_BYPASS skips update() and passes input 0 to output 0
+	enum { DEGRADE_NONE, DEGRADE_QUALITY, DEGRADE_BYPASS };
+	bool optional;
+	uint8_t degraded;
+	// The pool tier for blocks this object keeps between updates
+	uint8_t memory_tier;
+#if AUDIO_TRACE
+	uint32_t clocksHistogram[AUDIO_TRACE_BUCKETS];	// updates by clocks, in powers of 2
+#endif
 protected:
+	AudioContext *context;
 	unsigned char num_inputs;
-	static audio_block_t * allocate(void);
-	static void release(audio_block_t * block);
+	audio_block_t * allocate(void) { return context->allocate(); }
+	// A block for this object to keep, from its memory_tier
+	audio_block_t * allocateHeld(void) { return context->allocate(memory_tier); }
+	void release(audio_block_t * block) { context->release(block); }
 	void transmit(audio_block_t *block, unsigned char index = 0);
 	audio_block_t * receiveReadOnly(unsigned int index = 0);
 	audio_block_t * receiveWritable(unsigned int index = 0);
+	// Receive a block to keep for a while: it is moved to memory_tier
+	// when it is in the other one.  The data must not be written.
+	audio_block_t * receiveHeld(unsigned int index = 0);
+	// Objects with control inputs give their array in the constructor
+	void controlInputs(audio_control_t *queue, unsigned char num) {
+		for (int i=0; i < num; i++) {
+			queue[i].fresh = queue[i].started = false;
+		}
+		controlQueue = queue;
+		num_controls = num;
+	}
+	unsigned char num_controls;
+	// Control-rate sources send one value per block; receivers get it as
+	// a ramp from the last one, false when nothing came for this block
+	void transmitControl(float value, unsigned char index = 0);
+	bool receiveControl(unsigned int index, float &start, float &end);
 	//static void update_all(void) { software_isr(); }
 	//friend void software_isr(void);
 	friend class AudioConnection;
+	friend class AudioContext;
 	uint8_t numConnections;	
+	// Called for every object by set_sample_rate(), to recompute
+	// coefficients and sample counts from the new sample_rate
+	virtual void sample_rate_changed(void) { }
+	// Blocks this object keeps from one update to the next, for
+	// initialize_planned_memory()
+	virtual unsigned int blocks_held(void) { return 0; }
+	// Objects whose output is scale * input + offset, on one input, say so
+	// here.  update_all then runs chains of them as one pass over the block.
+	virtual bool fusable(void) { return false; }
+	virtual bool affine(unsigned int input, float &scale, float &offset) { return false; }
+	// Samples of output this object can still produce once all its inputs
+	// are silent (no blocks).  After that update_all lets it sleep until a
+	// block arrives.  -1, the default, means endless or unknown: never sleep.
+	virtual int32_t tail_samples(void) { return -1; }
+	// Setters call post() first.  When update_all runs on another task it
+	// queues the change and returns true; the audio task then passes it
+	// to command() at the next block boundary, which calls the setter again.
+	// offset is the sample of the coming block the change was timed for
+	// with AudioContext::at(); objects that can, keep it until update()
+	// gets there (see AudioBlockEvents), the others apply it at once.
+	bool post(uint8_t id, float a = 0.0f, float b = 0.0f, float c = 0.0f) {
+		return context->post(this, id, a, b, c);
+	}
+	virtual void command(uint8_t id, const float *value, unsigned int offset) { }
 private:
 	AudioConnection *destination_list;
 	audio_block_t **inputQueue;
-	virtual void update(void) = 0;
-	static audio_block_t *memory_pool;
-	static uint32_t memory_pool_available_mask[];
-	static uint16_t memory_pool_first_mask;	
+	audio_control_t *controlQueue;
+	// Every object has its own; this one only runs if update_all catches
+	// an object deleted without end() between its destructors
+	virtual void update(void) { }
+	AudioStream *next_stream;		// all streams of the context, in order of creation
+	uint16_t update_pending;		// unscheduled streams feeding this one
+	uint16_t update_index;			// position in the update_all list
+	bool update_scheduled;
+	bool update_reached;			// scratch for update_loop_start()
+	bool update_reaching;
+	bool ended;						// out of the graph, by end()
+	enum { UPDATE_STAGE_FIRST, UPDATE_STAGE_BRANCH, UPDATE_STAGE_LAST };
+	uint8_t update_stage;			// when update_all runs this, with 2 cores
+	uint16_t update_branch;			// lowest update_index of the branch
+	uint32_t update_branch_clocks;	// total clocks of the branch, in its first stream
+	AudioStream *fuse_next;			// next object of its chain of fusable objects
+	uint8_t fuse_input;				// the one input used by affine()
+	enum { FUSE_NONE = 0xFF };
+	bool fused;						// already run by the head of its chain
+	bool update_fused(void);
+	bool update_silent(void);
+	void update_bypass(void);
+	uint32_t silent_samples;		// since the last block on any input
+	void update_timed(void);
 	uint32_t clocksPerSecondSum;		
 };
 
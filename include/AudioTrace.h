@@ -0,0 +1,68 @@
+#ifndef audiotrace_h_
+#define audiotrace_h_
+
+#include "AudioStream.h"
+
+// Reports from the recording that -DAUDIO_TRACE=1 turns on
+
+#if AUDIO_TRACE
+
+#ifndef F_CPU
+#define F_CPU (CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ * 1000000U)
+#endif
+
+// The clocks of every update of every object so far, in powers of 2,
+// so the rare slow ones show next to the usual
+void histogramDisplay(AudioContext &context = AudioContext::global())
+{
+    AudioStream *p;
+    printf("Updates per clock range, n: count of updates taking 2^n to 2^(n+1) clocks\r\n");
+    for (p = context.first_update; p; p = p->next_update) {
+        if (!p->active) continue;
+        printf("%-31s", p->name);
+        for (int i = 0; i < AUDIO_TRACE_BUCKETS; i++) {
+            if (p->clocksHistogram[i]) printf(" %i:%u", i, p->clocksHistogram[i]);
+        }
+        printf("\r\n");
+    }
+}
+
+void histogramReset(AudioContext &context = AudioContext::global())
+{
+    for (AudioStream *p = context.first_update; p; p = p->next_update) {
+        memset(p->clocksHistogram, 0, sizeof(p->clocksHistogram));
+    }
+}
+
+// Print the trace as Chrome trace event JSON: save it to a file and open it
+// in chrome://tracing or ui.perfetto.dev, one row per core.  Recording
+// pauses while it prints.
+void traceExport(AudioContext &context = AudioContext::global())
+{
+    const float clocksPerMicrosecond = (float)F_CPU / 1000000.0f;
+    bool on = context.trace_on;
+    context.trace_on = false;
+    vTaskDelay(1);      // let the block in progress finish
+    uint32_t count = context.trace_count;
+    uint32_t first = (count > AUDIO_TRACE_EVENTS) ? count - AUDIO_TRACE_EVENTS : 0;
+    uint32_t origin = context.trace_events[first % AUDIO_TRACE_EVENTS].start;
+    for (uint32_t i = first; i < count; i++) {
+        uint32_t start = context.trace_events[i % AUDIO_TRACE_EVENTS].start;
+        if ((int32_t)(start - origin) < 0) origin = start;
+    }
+    printf("{\"traceEvents\":[\r\n");
+    for (uint32_t i = first; i < count; i++) {
+        const AudioContext::trace_event &e = context.trace_events[i % AUDIO_TRACE_EVENTS];
+        printf("{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%i,\"ts\":%.2f,\"dur\":%.2f}%s\r\n",
+            e.name ? e.name : "update_all", e.core,
+            (int32_t)(e.start - origin) / clocksPerMicrosecond,
+            (e.stop - e.start) / clocksPerMicrosecond,
+            (i + 1 < count) ? "," : "");
+    }
+    printf("]}\r\n");
+    context.trace_on = on;
+}
+
+#endif
+
+#endif
@@ -2,6 +2,7 @@
 #define cpudisplay_h_
 
 #include "Audiostream.h"
+#include "control_i2s.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -16,9 +17,9 @@ unsigned long IRAM_ATTR millis()
     return (unsigned long) (esp_timer_get_time() / 1000);
 }	
 
-void cpuDisplay()
+void cpuDisplay(AudioContext &context = AudioContext::global())
 {
-    const float maxTicksPerUpdate = (((float)F_CPU) / 44100.0f) * 128.0f;
+    const float maxTicksPerUpdate = (((float)F_CPU) / context.sample_rate) * AUDIO_BLOCK_SAMPLES;
     AudioStream *p;
     printf("%lu ms uptime\r\n\r\n", millis());
     printf("CPU 0 %5.2f%% [%5.2f%% max]  \r\n", cpu0Load, cpu0LoadMax);
@@ -26,10 +27,11 @@ void cpuDisplay()
     int clocks, clocksMax, clocksSec;
     float load, loadMax, loadSec;
     int totalClocks = 0, totalClocksMax = 0;
+    int coreClocks[2] = {0, 0};
     printf("                                |     Per Update     |   Per Second   |\r\n"); 
-    printf("%-31s %6s %7s %6s %6s %9s\r\n", "Audio Object", "Min %", "Clocks", "Max %", "%", "Clocks"); 
-    printf("----------------------------------------------------------------------\r\n");
-    for (p = AudioStream::first_update; p; p = p->next_update) {
+    printf("%-31s %6s %7s %6s %6s %9s %4s\r\n", "Audio Object", "Min %", "Clocks", "Max %", "%", "Clocks", "Core"); 
+    printf("---------------------------------------------------------------------------\r\n");
+    for (p = context.first_update; p; p = p->next_update) {
         if (p->active) {
             if(!p->blocking){
                 clocks = p->clocksPerUpdateMin;
@@ -38,17 +40,30 @@ void cpuDisplay()
                 load = 100.0f * ((float)clocks / maxTicksPerUpdate);
                 loadMax = 100.0f * ((float)clocksMax / maxTicksPerUpdate);
                 loadSec = 100.0f * ((float)clocksSec/((float)F_CPU));
-                printf("%-31s %6.2f %7i %6.2f %6.2f %9i\r\n", p->name, load, clocks, loadMax, loadSec, clocksSec);
+                printf("%-31s %6.2f %7i %6.2f %6.2f %9i %4i\r\n", p->name, load, clocks, loadMax, loadSec, clocksSec, p->core);
                 totalClocks += clocks;
                 totalClocksMax += clocksMax;
+                coreClocks[p->core & 1] += clocksSec;
             }	
             else{
-                printf("%-31s %6s %7s %6s %6s %9s\r\n", p->name, "-", "-", "-", "-", "-");
+                printf("%-31s %6s %7s %6s %6s %9s %4i\r\n", p->name, "-", "-", "-", "-", "-", p->core);
             }		
         }
     }
     printf("                                ---------------------\r\n");
     printf("%31s %6.2f %7i %6.2f\r\n", "", 100.0f * ((float)totalClocks / maxTicksPerUpdate), totalClocks, 100.0f * ((float)totalClocksMax / maxTicksPerUpdate));
+    printf("Scheduling overhead: %i clocks per update [%i max]\r\n", context.clocksOverhead, context.clocksOverheadMax);
+    printf("Audio memory: %u blocks used [%u max] of %u, graph needs %u\r\n", context.memory_used, context.memory_used_max, context.memory_size, context.memory_needed);
+    if (context.memory_tier_size[AudioContext::MEMORY_PSRAM]) {
+        printf("  internal: %u used [%u max] of %u, PSRAM: %u used [%u max] of %u\r\n",
+            context.memory_tier_used[AudioContext::MEMORY_INTERNAL], context.memory_tier_used_max[AudioContext::MEMORY_INTERNAL],
+            context.memory_tier_size[AudioContext::MEMORY_INTERNAL], context.memory_tier_used[AudioContext::MEMORY_PSRAM],
+            context.memory_tier_used_max[AudioContext::MEMORY_PSRAM], context.memory_tier_size[AudioContext::MEMORY_PSRAM]);
+    }
+    printf("Deadline: %u clocks per block, last %u [%u max], %u overruns, degrade level %u\r\n", context.deadlineClocks, context.blockClocks, context.blockClocksMax, context.overruns, context.degradeLevel);
+    printf("I2S: %u underruns (last at sample %u), %u overruns (last at sample %u)%s\r\n", AudioControlI2S::underruns, AudioControlI2S::underrunTime,
+        AudioControlI2S::overruns, AudioControlI2S::overrunTime, AudioControlI2S::resync ? ", resync on" : "");
+    printf("Audio per core: 0 %5.2f%%  1 %5.2f%%\r\n", 100.0f * ((float)coreClocks[0]/((float)F_CPU)), 100.0f * ((float)coreClocks[1]/((float)F_CPU)));
 }
 
 #ifdef __cplusplus
@@ -0,0 +1,53 @@
+#ifndef analyze_tap_h_
+#define analyze_tap_h_
+
+#include "AudioStream.h"
+#include "freertos/FreeRTOS.h"
+
+// Blocks the ring holds by default, for the worker to fall behind by
+#ifndef AUDIO_TAP_BLOCKS
+#define AUDIO_TAP_BLOCKS 8
+#endif
+
+// Gets blocks * AUDIO_BLOCK_SAMPLES samples, oldest first
+typedef void (*AudioTapCallback)(const float *samples, unsigned int blocks, void *arg);
+
+// Copies its input into a ring that a task on another core empties,
+// calling back with a batch of blocks at a time.  Metering, FFT displays
+// or tuners then run outside update_all and its deadline.  When the
+// callback can't keep up, blocks are dropped and counted, never waited for.
+class AudioAnalyzeTap : public AudioStream
+{
+public:
+	AudioAnalyzeTap(void) : AudioStream(1, inputQueueArray, "AudioAnalyzeTap"),
+		drops(0), ring(NULL), head(0), tail(0), task(NULL), stopper(NULL), stopped(false) { initialised = true; }
+	~AudioAnalyzeTap();
+	bool begin(AudioTapCallback callback, void *arg = NULL, unsigned int batch = 1,
+		unsigned int blocks = AUDIO_TAP_BLOCKS, int core = 0, unsigned int priority = 5);
+	uint32_t drops;			// blocks lost because the callback fell behind
+	virtual void update(void);
+private:
+	static void worker(void *parameter);
+	// head and tail count blocks modulo twice the ring, which any ring
+	// size divides, so full and empty differ and the index never jumps
+	uint32_t filled(uint32_t head, uint32_t tail) {
+		return head >= tail ? head - tail : 2 * ring_blocks + head - tail;
+	}
+	uint32_t advance(uint32_t count, uint32_t blocks) {
+		count += blocks;
+		return count >= 2 * ring_blocks ? count - 2 * ring_blocks : count;
+	}
+	audio_block_t *inputQueueArray[1];
+	float *ring;
+	uint32_t ring_blocks;		// a multiple of batch_blocks, so each batch is contiguous
+	uint32_t batch_blocks;
+	uint32_t head;				// blocks written, by update, mod 2 * ring_blocks
+	uint32_t tail;				// blocks done, by the worker, mod 2 * ring_blocks
+	AudioTapCallback callback;
+	void *callback_arg;
+	void *task;
+	void *stopper;				// the task waiting in the destructor for the worker to stop
+	bool stopped;				// by the worker, as its last use of the tap
+};
+
+#endif
@@ -117,6 +117,11 @@ public:
 	// @return True on success, false on failure.
 	bool SetI2sSampleRate(I2sSampleRate_t rate);
 
+	// Samplerate setting for a rate in Hz.
+	// @param hz   Samplerate, eg. AudioContext::global().sample_rate.
+	// @return The nearest setting at or above hz.
+	static I2sSampleRate_t SampleRate(float hz);
+
 	// Configure I2S mode (master/slave).
 	// @param mode   Mode.
 	// @return True on success, false on failure.
@@ -3,27 +3,96 @@
 
 #include "AudioStream.h"
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "driver/i2s.h"
 #include "output_i2s.h"
 #include "input_i2s.h"
+#include "io_i2s.h"
 #include "esp_log.h"
 
-#define MCLK (AUDIO_SAMPLE_RATE_EXACT * 384)
+#define MCLK ((int)(AudioContext::global().sample_rate * 384))
+
+// The DMA buffers the built-in setups give the driver, per direction.
+// By default each holds one audio block, so every read or write hands
+// whole blocks to the driver, whatever AUDIO_BLOCK_SAMPLES is.
+#ifndef AUDIO_I2S_DMA_BUFFERS
+#define AUDIO_I2S_DMA_BUFFERS AudioControlI2S::LATENCY_BALANCED
+#endif
 
 class AudioControlI2S
 {
 public:
 	AudioControlI2S(void){}
 	virtual ~AudioControlI2S();
+	// DMA buffers of one block each: fewer for less latency, more to ride
+	// out longer stalls of the audio task, like Wi-Fi or flash writes
+	enum {
+		LATENCY_LOW = 2,
+		LATENCY_BALANCED = 4,
+		LATENCY_ROBUST = 8,
+	};
+	// Set before the setup (ac101(), default_...()): a profile above, or
+	// count buffers of length frames.  A block must be a whole number of
+	// buffers and all of them more than a block; the driver takes 2 to 128
+	// buffers of 8 to 1024 frames, and up to 4092 bytes each.
+	static bool latency(unsigned int profile) { return buffers(profile, AUDIO_BLOCK_SAMPLES); }
+	static bool buffers(unsigned int count, unsigned int length = AUDIO_BLOCK_SAMPLES);
+	// Samples the output DMA buffers hold once running: what the DMA adds
+	// to the output's latency
+	static uint32_t latencySamples(void) { return (uint32_t)dma_buffers * dma_length; }
+	// Glitches the driver reported: output buffers that ran out before the
+	// next block came (the DMA then repeats or, with tx_desc_auto_clear,
+	// zeros them) and input blocks dropped because nothing read them in
+	// time.  Each with the sample_time() of the last one.
+	static uint32_t underruns;
+	static uint32_t underrunTime;
+	static uint32_t overruns;
+	static uint32_t overrunTime;
+	// After a glitch, start both directions again on the next update, so
+	// input and output are back in step (and AudioIOI2S back to its
+	// latencySamples()) instead of staying a block apart.  Off by default:
+	// the restart itself drops the buffered audio.
+	static bool resync;
 	void start(i2s_port_t i2s_port, i2s_config_t* i2s_config, i2s_pin_config_t* i2s_pin_config, bool outputMCLK);
     void default_codec_rx_tx_24bit();
     void default_adc_dac();
 		void ac101();
 	friend class AudioInputI2S;
     friend class AudioOutputI2S;
+    friend class AudioIOI2S;
 protected:
+	// What the driver takes, shared by the device and host builds
+	static bool valid_buffers(unsigned int count, unsigned int length) {
+		// and more than a block in all, to fill one while another plays
+		if (count < 2 || count > 128 || length < 8 || length > 1024 ||
+				AUDIO_BLOCK_SAMPLES % length != 0 || count * length <= AUDIO_BLOCK_SAMPLES) {
+			ESP_LOGE("AudioControlI2S", "can't use %u DMA buffers of %u frames with blocks of %d",
+				count, length, AUDIO_BLOCK_SAMPLES);
+			return false;
+		}
+		return true;
+	}
+	static esp_err_t install(i2s_port_t i2s_port, const i2s_config_t *i2s_config);
+	static void wait_buffer(i2s_event_type_t type);
+	static size_t read(void *dst, size_t bytes);
+	static size_t write(const void *src, size_t bytes);
+	static void restart(void);
+	static bool resync_due(void);
+	static void unpack(const int32_t *src, float *left, float *right, uint32_t &left_bits, uint32_t &right_bits);
+	static void pack(int32_t *dst, const float *left, const float *right);
+	// bytes of one block of frames in the DMA buffers
+	static size_t block_bytes(void) { return AUDIO_BLOCK_SAMPLES * sizeof(uint32_t) * (bits == 16 ? 1 : 2); }
 	static bool configured;
 	static uint8_t bits;
+	static i2s_port_t port;
+	static QueueHandle_t events;
+	static uint8_t buffer_count;		// for the next setup
+	static uint16_t buffer_length;
+	static uint8_t dma_buffers;		// installed
+	static uint16_t dma_length;
+	static uint8_t rx_ready, tx_ready;	// DMA buffers done that the I2S objects haven't had yet
+	static bool reading, writing;		// since the last restart
+	static bool glitched;
 };
 
 #endif
\ No newline at end of file
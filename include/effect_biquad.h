@@ -2,6 +2,7 @@
 #define effect_biquad_h_
 
 #include "AudioStream.h"
+#include "AudioSmoothedValue.h"
 #include "Arduino.h"
 //#include "../lib/sndfilter/biquad.h"
 
@@ -11,16 +12,20 @@ typedef struct {
 	float b2;
 	float a1;
 	float a2;
-	float xn1;
-	float xn2;
-	float yn1;
-	float yn2;
+	float w[2];		// direct form II delay elements
 } biquad_state_st;
 
 class AudioFilterBiquad : public AudioStream
 {
 public:
-	AudioFilterBiquad(void) : AudioStream(1, inputQueueArray, "AudioEffectBiquad") { }
+	// control input 0: the frequency in Hz, redesigned once a block
+	AudioFilterBiquad(void) : AudioStream(1, inputQueueArray, "AudioEffectBiquad"),
+		design_freq(0.0f, AudioSmoothedValue::EXPONENTIAL) {
+		controlInputs(controlQueueArray, 1);
+		design_freq.time(AUDIO_SMOOTHING_MS, sample_rate);
+		state_reset();
+		state_passthrough();
+	}
 
     void lowpass( float cutoff, float resonance);
     void highpass( float cutoff, float resonance);
@@ -34,11 +39,37 @@ public:
 	virtual void update(void);
 
 private:
+    enum { DESIGN_NONE, DESIGN_LOWPASS, DESIGN_HIGHPASS, DESIGN_BANDPASS, DESIGN_NOTCH,
+           DESIGN_PEAKING, DESIGN_ALLPASS, DESIGN_LOWSHELF, DESIGN_HIGHSHELF };
+    void set_design(uint8_t type, float freq, float Q, float gain);
+    void design();
+    void design_lowpass(float cutoff, float resonance);
+    void design_highpass(float cutoff, float resonance);
+    void design_bandpass(float freq, float Q);
+    void design_notch(float freq, float Q);
+    void design_peaking(float freq, float Q, float gain);
+    void design_allpass(float freq, float Q);
+    void design_lowshelf(float freq, float Q, float gain);
+    void design_highshelf(float freq, float Q, float gain);
+    // the design types double as command ids
+    virtual void command(uint8_t id, const float *value, unsigned int offset) {
+        set_design(id, value[0], value[1], value[2]);
+    }
+    virtual void sample_rate_changed(void);
+    // rings on after the input stops, until the poles have decayed
+    virtual int32_t tail_samples(void) { return tail; }
+    uint8_t design_type = DESIGN_NONE;  // the filter designed, to redo it at
+    AudioSmoothedValue design_freq;     // the next step of a frequency change
+    float design_Q, design_gain;        // or a new sample rate
     void state_reset();
     void state_scale(float amt);
     void state_passthrough();
     void state_zero();
+    void state_tail();
+    int32_t tail = 0;                   // samples to -100 dB, for the coefficients
+    uint32_t ringing = 0;               // samples run on zeros since the last block
 	audio_block_t *inputQueueArray[1];
+	audio_control_t controlQueueArray[1];
     biquad_state_st biquadState;
 };
 
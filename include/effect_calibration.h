@@ -20,6 +20,16 @@ public:
 
 	virtual void update(void);
 private:
+	// silence in is still c out, or the override value: only sleep when
+	// that is silence too
+	virtual int32_t tail_samples(void) { return (c != 0.0f || inputOverrideEnable) ? -1 : 0; }
+	virtual bool fusable(void) { return true; }
+	virtual bool affine(unsigned int input, float &scale, float &offset) {
+		if (averagingEnable || inputOverrideEnable) return false;
+		scale = m;
+		offset = c;
+		return true;
+	}
 	bool averagingEnable = false;	
 	float inputAverage, outputAverage;
 	bool inputOverrideEnable = false;
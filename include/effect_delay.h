@@ -41,11 +41,15 @@
 class AudioEffectDelay : public AudioStream
 {
 public:
+	// control inputs 0 to 7: the delay of each channel in ms, crossfaded
 	AudioEffectDelay() : AudioStream(1, inputQueueArray, "AudioEffectDelay") {
+		controlInputs(controlQueueArray, 8);
 		activemask = 0;
 		headindex = 0;
 		tailindex = 0;
 		maxblocks = 0;
+		// the delay line lives in PSRAM when AudioMemoryPSRAM() gave a pool
+		memory_tier = AudioContext::MEMORY_PSRAM;
 	
     //queue = (audio_block_t **)heap_caps_malloc(DELAY_QUEUE_SIZE * sizeof(audio_block_t), MALLOC_CAP_SPIRAM);
     //queue = (audio_block_t **)ps_malloc(DELAY_QUEUE_SIZE * sizeof(audio_block_t));
@@ -63,10 +67,17 @@ public:
 
 		if (channel >= 8) return;
 		if (milliseconds < 0.0) milliseconds = 0.0;
-		uint32_t n = (milliseconds*(AUDIO_SAMPLE_RATE_EXACT/1000.0))+0.5;
+		if (post(COMMAND_DELAY, channel, milliseconds)) return;
+		delay_ms[channel] = milliseconds;
+		uint32_t n = (milliseconds*(sample_rate/1000.0))+0.5;
 		uint32_t nmax = AUDIO_BLOCK_SAMPLES * (DELAY_QUEUE_SIZE-1);
 		if (n > nmax) n = nmax;
 		uint32_t blks = (n + (AUDIO_BLOCK_SAMPLES-1)) / AUDIO_BLOCK_SAMPLES + 1;
+		if ((activemask & (1<<channel)) && n != position[channel]) {
+			// crossfade from the old position over the next block
+			fade_position[channel] = position[channel];
+			fademask |= (1<<channel);
+		}
 		if (!(activemask & (1<<channel))) {
 			// enabling a previously disabled channel
 			position[channel] = n;
@@ -86,38 +97,60 @@ public:
 	}
 	void disable(uint8_t channel) {
 		if (channel >= 8) return;
+		if (post(COMMAND_DISABLE, channel)) return;
 		// diable this channel
 		activemask &= ~(1<<channel);
+		fademask &= ~(1<<channel);
 		// recompute maxblocks for remaining enabled channels
 		recompute_maxblocks();
 	}
 	virtual void update(void);
 private:
+	enum { COMMAND_DELAY, COMMAND_DISABLE };
+	virtual void command(uint8_t id, const float *value, unsigned int offset) {
+		if (id == COMMAND_DELAY) delay(value[0], value[1]);
+		else if (id == COMMAND_DISABLE) disable(value[0]);
+	}
+	virtual unsigned int blocks_held(void) { return maxblocks; }
+	virtual int32_t tail_samples(void) { return (maxblocks + 1) * AUDIO_BLOCK_SAMPLES; }	// until the queue is empty
+	virtual void sample_rate_changed(void) {
+		for (uint8_t channel = 0; channel < 8; channel++) {
+			if (activemask & (1<<channel)) delay(channel, delay_ms[channel]);
+		}
+	}
 	void recompute_maxblocks(void) {
 		uint32_t max=0;
 		uint32_t channel = 0;
 		do {
 			if (activemask & (1<<channel)) {
 				uint32_t n = position[channel];
+				// until the crossfade is over, keep the old position's blocks too
+				if ((fademask & (1<<channel)) && fade_position[channel] > n) n = fade_position[channel];
 				n = (n + (AUDIO_BLOCK_SAMPLES-1)) / AUDIO_BLOCK_SAMPLES + 1;
 				if (n > max) max = n;
 			}
 		} while(++channel < 8);
 		maxblocks = max;
 	}
+	void read_delayed(uint32_t head, uint32_t delay, float *data);
 	uint8_t activemask;   // which output channels are active
+	uint8_t fademask = 0; // which output channels crossfade this block
 	uint16_t headindex;    // head index (incoming) data in quueu
 	uint16_t tailindex;    // tail index (outgoing) data from queue
 	uint16_t maxblocks;    // number of blocks needed in queue
 #if DELAY_QUEUE_SIZE * AUDIO_BLOCK_SAMPLES < 65535
 	uint16_t position[8]; // # of sample delay for each channel
+	uint16_t fade_position[8]; // the delay a channel is crossfading away from
 #else
 	uint32_t position[8]; // # of sample delay for each channel
+	uint32_t fade_position[8]; // the delay a channel is crossfading away from
 #endif
+	float delay_ms[8];    // delay time of each channel, as set
 
   //audio_block_t **queue;
 	audio_block_t *queue[DELAY_QUEUE_SIZE];
 	audio_block_t *inputQueueArray[1];
+	audio_control_t controlQueueArray[8];
 };
 
 #endif
\ No newline at end of file
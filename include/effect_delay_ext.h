@@ -37,14 +37,27 @@ enum AudioEffectDelayMemoryType_t {
 class AudioEffectDelayExternal : public AudioStream
 {
 public:
-	AudioEffectDelayExternal() : AudioStream(1, inputQueueArray, "AudioEffectDelayExternal") { } 
+	// control inputs 0 to 7: the delay of each channel in ms, crossfaded
+	AudioEffectDelayExternal() : AudioStream(1, inputQueueArray, "AudioEffectDelayExternal") {
+		controlInputs(controlQueueArray, 8);
+		memory_begin = NULL;
+		memory_type = AUDIO_MEMORY_UNDEFINED;
+		activemask = 0;
+	}
   boolean delay(uint8_t channel, float milliseconds) {
 		if (channel >= 8 || memory_type >= AUDIO_MEMORY_UNDEFINED) return true;
 		if (milliseconds < 0.0) milliseconds = 0.0;
-		uint32_t n = (milliseconds*(AUDIO_SAMPLE_RATE_EXACT/1000.0f))+0.5f;
+		delay_ms[channel] = milliseconds;
+		uint32_t n = (milliseconds*(sample_rate/1000.0f))+0.5f;
 		n += AUDIO_BLOCK_SAMPLES;
 		if (n > memory_length - AUDIO_BLOCK_SAMPLES)
 			n = memory_length - AUDIO_BLOCK_SAMPLES;
+		if (post(COMMAND_DELAY, channel, milliseconds)) return false;
+		if ((activemask & (1<<channel)) && n != delay_length[channel]) {
+			// crossfade from the old length over the next block
+			fade_length[channel] = delay_length[channel];
+			fademask |= (1<<channel);
+		}
 		delay_length[channel] = n;
 		uint8_t mask = activemask;
 		activemask = mask | (1<<channel);
@@ -52,26 +65,48 @@ public:
 	}
 	void disable(uint8_t channel) {
 		if (channel >= 8) return;
+		if (post(COMMAND_DISABLE, channel)) return;
+		fademask &= ~(1<<channel);
 		uint8_t mask = activemask & ~(1<<channel);
 		activemask = mask;
 	}
 	virtual void update(void);
 	void initialize(uint32_t samples);
 private:
-
+	enum { COMMAND_DELAY, COMMAND_DISABLE };
+	virtual void command(uint8_t id, const float *value, unsigned int offset) {
+		if (id == COMMAND_DELAY) delay(value[0], value[1]);
+		else if (id == COMMAND_DISABLE) disable(value[0]);
+	}
+	virtual void sample_rate_changed(void) {
+		for (uint8_t channel = 0; channel < 8; channel++) {
+			if (activemask & (1<<channel)) delay(channel, delay_ms[channel]);
+		}
+	}
+	virtual int32_t tail_samples(void) {
+		uint32_t max = 0;
+		for (uint8_t channel = 0; channel < 8; channel++) {
+			if ((activemask & (1<<channel)) && delay_length[channel] > max) max = delay_length[channel];
+			if ((fademask & (1<<channel)) && fade_length[channel] > max) max = fade_length[channel];
+		}
+		return max;
+	}
 	void read(uint32_t address, uint32_t count, float *data);
+	void read_delayed(uint32_t length, float *data);
 	void write(uint32_t address, uint32_t count, const float *data);
-	void zero(uint32_t address, uint32_t count) {
-		uint32_t addr = memory_begin + address;
-    memset((void *)addr, 0, count*sizeof(float));
-	}
-	uint32_t memory_begin;    // the first address in the memory we're using
+	void zero(uint32_t address, uint32_t count);
+	float *memory_begin;      // the first sample in the memory we're using
 	uint32_t memory_length;   // the amount of memory we're using
 	uint32_t head_offset;     // head index (incoming) data into external memory
-	uint32_t delay_length[8]; // # of sample delay for each channel (128 = no delay)
+	uint32_t zero_count;      // samples of silence stored just before head_offset
+	uint32_t delay_length[8]; // # of sample delay for each channel (AUDIO_BLOCK_SAMPLES = no delay)
+	uint32_t fade_length[8];  // the delay a channel is crossfading away from
+	float    delay_ms[8];     // delay time of each channel, as set
 	uint8_t  activemask;      // which output channels are active
+	uint8_t  fademask = 0;    // which output channels crossfade this block
 	uint8_t  memory_type;     // 0=SPIRAM
 	audio_block_t *inputQueueArray[1];
+	audio_control_t controlQueueArray[8];
 };
 
 #endif
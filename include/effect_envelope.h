@@ -28,9 +28,10 @@
 #define effect_envelope_h_
 
 #include "AudioStream.h"
+#include "AudioBlockEvents.h"
 #include "freertos/FreeRTOS.h"
 
-#define SAMPLES_PER_MSEC (AUDIO_SAMPLE_RATE_EXACT/1000.0)
+#define SAMPLES_PER_MSEC (sample_rate/1000.0f)
 
 class AudioEffectEnvelope : public AudioStream
 {
@@ -49,16 +50,20 @@ public:
 	void noteOn();
 	void noteOff();
 	void delay(float milliseconds) {
+		delay_ms = milliseconds;
 		delay_count = milliseconds2count(milliseconds);
 	}
 	void attack(float milliseconds) {
+		attack_ms = milliseconds;
 		attack_count = milliseconds2count(milliseconds);
 		if (attack_count == 0) attack_count = 1;
 	}
 	void hold(float milliseconds) {
+		hold_ms = milliseconds;
 		hold_count = milliseconds2count(milliseconds);
 	}
 	void decay(float milliseconds) {
+		decay_ms = milliseconds;
 		decay_count = milliseconds2count(milliseconds);
 		if (decay_count == 0) decay_count = 1;
 	}
@@ -68,10 +73,12 @@ public:
 		sustain_mult = level * 1073741824.0;
 	}
 	void release(float milliseconds) {
+		release_ms = milliseconds;
 		release_count = milliseconds2count(milliseconds);
 		if (release_count == 0) release_count = 1;
 	}
 	void releaseNoteOn(float milliseconds) {
+		release_forced_ms = milliseconds;
 		release_forced_count = milliseconds2count(milliseconds);
 		if (release_count == 0) release_count = 1;
 	}
@@ -80,6 +87,29 @@ public:
 	using AudioStream::release;
 	virtual void update(void);
 private:
+	// noteOn and noteOff timed inside a block start at the 8 sample step
+	// on or after their time
+	enum { COMMAND_NOTE_ON, COMMAND_NOTE_OFF };
+	virtual void command(uint8_t id, const float *value, unsigned int offset) {
+		if (offset && events.add(id, value, offset)) return;
+		if (id == COMMAND_NOTE_ON) noteOn();
+		else if (id == COMMAND_NOTE_OFF) noteOff();
+	}
+	void apply_events(unsigned int offset) {
+		while (!events.empty() && events.next() <= offset) {
+			const AudioBlockEvents::event &e = events.pop();
+			command(e.id, e.value, 0);
+		}
+	}
+	AudioBlockEvents events;
+	virtual void sample_rate_changed(void) {
+		delay(delay_ms);
+		attack(attack_ms);
+		hold(hold_ms);
+		decay(decay_ms);
+		release(release_ms);
+		releaseNoteOn(release_forced_ms);
+	}
 	uint16_t milliseconds2count(float milliseconds) {
 		if (milliseconds < 0.0) milliseconds = 0.0;
 		uint32_t c = ((uint32_t)(milliseconds*SAMPLES_PER_MSEC)+7)>>3;
@@ -101,6 +131,8 @@ private:
 	int32_t  sustain_mult;
 	uint16_t release_count;
 	uint16_t release_forced_count;
+	// settings as set, in milliseconds
+	float delay_ms, attack_ms, hold_ms, decay_ms, release_ms, release_forced_ms;
 
 };
 
@@ -52,7 +52,9 @@ private:
   short  l_circ_idx;
   int    delay_depth;
   int    delay_offset_idx;
-  int    delay_rate_incr;
+  virtual void sample_rate_changed(void) { delay_rate_incr = (2.0f * PI * delay_rate) / sample_rate; }
+  float  delay_rate;
+  float  delay_rate_incr;
   float  l_delay_rate_phase;
 };
 
@@ -35,6 +35,7 @@ public:
 	AudioEffectMultiply() : AudioStream(2, inputQueueArray, "AudioEffectMultiply") { initialised = true; }
 	virtual void update(void);
 private:
+	virtual int32_t tail_samples(void) { return 0; }
 	audio_block_t *inputQueueArray[2];
 };
 
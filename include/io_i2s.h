@@ -0,0 +1,39 @@
+#ifndef io_i2s_h_
+#define io_i2s_h_
+
+#include "AudioStream.h"
+#include "freertos/FreeRTOS.h"
+#include "driver/i2s.h"
+#include "control_i2s.h"
+
+// Input and output of one I2S port in one object, in place of an
+// AudioInputI2S and an AudioOutputI2S.  Every update first writes what
+// the graph made of the last input block, then reads the next one, so a
+// block takes exactly one update through the graph, whatever order the
+// objects were made in.
+//
+// On its first update it starts the port again, with both directions
+// in step.  The room for late updates is the output DMA buffers'
+// (AudioControlI2S::latency()); silence written ahead of the first
+// block would only pile up in the input buffers.
+class AudioIOI2S : public AudioStream
+{
+public:
+	AudioIOI2S(void) : AudioStream(2, inputQueueArray, "AudioIOI2S") {
+		context->blockingObjectRunning = true;
+		blocking = true;
+		initialised = true;
+	}		//blockingObjectRunning - let's the audiostream loop know that something will throttle the loop
+	virtual void update(void);
+	// Samples from one coming in on the I2S port to the same one going
+	// out: a block, as it fills and then goes through the graph, and a
+	// turn of the output DMA buffers.  The codec's own converters and
+	// filters come on top.
+	uint32_t latencySamples(void);
+private:
+	audio_block_t *inputQueueArray[2];
+	int32_t sampleBuffer[AUDIO_BLOCK_SAMPLES * 2];
+	bool started = false;
+};
+
+#endif
@@ -28,14 +28,21 @@
 #define mixer_h_
 
 #include "AudioStream.h"
+#include "AudioSmoothedValue.h"
+#include "AudioBlockEvents.h"
 #include <math.h>
 #include "freertos/FreeRTOS.h"
 
 class AudioMixer4 : public AudioStream
 {
 public:
+	// control inputs 0 to 3: the gain of each channel
 	AudioMixer4(void) : AudioStream(4, inputQueueArray, "AudioMixer4") {
-		for (int i=0; i<4; i++) multiplier[i] = 1.0;
+		controlInputs(controlQueueArray, 4);
+		for (int i=0; i<4; i++) {
+			multiplier[i].jump(1.0f);
+			multiplier[i].time(AUDIO_SMOOTHING_MS, sample_rate);
+		}
 		initialised = true;
 	}
 	virtual void update(void);
@@ -43,41 +50,89 @@ public:
 		if (channel >= 4) return;
 		if (gain > 100000.0f) gain = 100000.0f;   //100000 = 100db
 		else if (gain < -100000.0f) gain = -100000.0f;
-		multiplier[channel] = gain; // TODO: proper roundoff?
+		if (post(COMMAND_GAIN, channel, gain)) return;
+		multiplier[channel].set(gain); // TODO: proper roundoff?
 	}
     void gainDb(unsigned int channel, float db, bool invert){
         if (channel >= 4) return;
         if (db > 100.0f) db = 100.0f;
 		else if (db < -100.0f) db = -100.0f;
         if(invert)
-            multiplier[channel] = powf(10.0f,db/20.0f) * -1.0;
+            gain(channel, powf(10.0f,db/20.0f) * -1.0);
         else
-            multiplier[channel] = powf(10.0f,db/20.0f);   
+            gain(channel, powf(10.0f,db/20.0f));
     }
+	// time gain changes take, 0 for none
+	void smoothing(float milliseconds) {
+		for (int i=0; i<4; i++) multiplier[i].time(milliseconds, sample_rate);
+	}
 private:
-	float multiplier[4];
+	enum { COMMAND_GAIN };
+	virtual void command(uint8_t id, const float *value, unsigned int offset) {
+		if (id == COMMAND_GAIN) gain(value[0], value[1]);
+	}
+	virtual void sample_rate_changed(void) {
+		for (int i=0; i<4; i++) multiplier[i].rate(sample_rate);
+	}
+	virtual int32_t tail_samples(void) { return 0; }
+	virtual bool fusable(void) { return true; }
+	virtual bool affine(unsigned int input, float &scale, float &offset) {
+		if (multiplier[input & 3].ramping()) return false;
+		scale = multiplier[input & 3].value();
+		offset = 0.0f;
+		return true;
+	}
+	AudioSmoothedValue multiplier[4];
 	audio_block_t *inputQueueArray[4];
+	audio_control_t controlQueueArray[4];
 };
 
 class AudioAmplifier : public AudioStream
 {
 public:
+	// control input 0: the gain
 	AudioAmplifier(void) : AudioStream(1, inputQueueArray, "AudioAmplifier"), multiplier(1.0) {
+		controlInputs(controlQueueArray, 1);
+		multiplier.time(AUDIO_SMOOTHING_MS, sample_rate);
 	}
 	virtual void update(void);
 	void gain(float n) {
 		if (n > 100000.0f) n = 100000.0f;       //100000 = 100db
 		else if (n < -100000.0f) n = -100000.0f;
-		multiplier = n;
+		if (post(COMMAND_GAIN, n)) return;
+		multiplier.set(n);
 	}
     void gainDb(float db){
         if (db > 100.0f) db = 100.0f;
 		else if (db < -100.0f) db = -100.0f;
-        multiplier = powf(10.0f,db/20.0f);
+        gain(powf(10.0f,db/20.0f));
     }
+	// time gain changes take, 0 for none
+	void smoothing(float milliseconds) {
+		multiplier.time(milliseconds, sample_rate);
+	}
 private:
-	float multiplier;
+	enum { COMMAND_GAIN };
+	virtual void command(uint8_t id, const float *value, unsigned int offset) {
+		// asleep, its output is silence until the next block anyway
+		if (offset && !sleeping && events.add(id, value, offset)) return;
+		if (id == COMMAND_GAIN) gain(value[0]);
+	}
+	void update_events(void);
+	void update_control(float start, float end);
+	virtual void sample_rate_changed(void) { multiplier.rate(sample_rate); }
+	virtual int32_t tail_samples(void) { return events.empty() ? 0 : -1; }
+	virtual bool fusable(void) { return true; }
+	virtual bool affine(unsigned int input, float &scale, float &offset) {
+		if (multiplier.ramping() || !events.empty()) return false;
+		scale = multiplier.value();
+		offset = 0.0f;
+		return true;
+	}
+	AudioSmoothedValue multiplier;
+	AudioBlockEvents events;
 	audio_block_t *inputQueueArray[1];
+	audio_control_t controlQueueArray[1];
 };
 
 #endif
\ No newline at end of file
@@ -10,7 +10,7 @@ class AudioOutputI2S : public AudioStream
 {
 public:
 	AudioOutputI2S(void) : AudioStream(2, inputQueueArray, "AudioOutputI2S") { 
-		blockingObjectRunning = true; 
+		context->blockingObjectRunning = true; 
 		blocking = true; 
 		initialised = true; 
 	}		//blockingObjectRunning - let's the audiostream loop know that something will throttle the loop
@@ -22,8 +22,10 @@ public:
 	virtual void update(void);
 private:
 	void configure(void);
+	void readSamples(void);
 	drwav* pWav;
-	float* pSampleData = NULL;
+	void* pSampleData = NULL;	//float, or int32_t for PCM files
+	bool pcm;					//PCM file, read as 32-bit and converted in update()
 	bool fileLoaded;
 	bool playback;
 	int samplePointer;			//Current sample pointer
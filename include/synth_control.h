@@ -0,0 +1,121 @@
+#ifndef synth_control_h_
+#define synth_control_h_
+
+#include "AudioStream.h"
+#include "synth_waveform.h"
+
+// Control-rate sources: one value per block, for AudioControlConnection
+// to the gain, frequency or delay time of another object, where an
+// audio-rate waveform would compute 128 values for the same job.
+
+class AudioSynthControlLFO : public AudioStream
+{
+public:
+	AudioSynthControlLFO() : AudioStream(0, NULL, "AudioSynthControlLFO"),
+		phase(0), increment(0), magnitude(1.0f), level(0), shape(WAVEFORM_SINE) {
+		initialised = true;
+	}
+	virtual void update(void);
+	void frequency(float freq) {
+		if (freq < 0.0f) freq = 0.0f;
+		if (post(COMMAND_FREQUENCY, freq)) return;
+		frequency_hz = freq;
+		increment = freq * AUDIO_BLOCK_SAMPLES / sample_rate;
+	}
+	// the output is offset + amplitude * waveform, eg. a gain or a frequency in Hz
+	void amplitude(float n) {
+		if (post(COMMAND_AMPLITUDE, n)) return;
+		magnitude = n;
+	}
+	void offset(float n) {
+		if (post(COMMAND_OFFSET, n)) return;
+		level = n;
+	}
+	// WAVEFORM_SINE, _TRIANGLE, _SQUARE, _SAWTOOTH or _SAWTOOTH_REVERSE
+	void begin(short t_type) {
+		if (post(COMMAND_BEGIN, t_type)) return;
+		shape = t_type;
+		phase = 0;
+	}
+private:
+	enum { COMMAND_FREQUENCY, COMMAND_AMPLITUDE, COMMAND_OFFSET, COMMAND_BEGIN };
+	virtual void command(uint8_t id, const float *value, unsigned int offset) {
+		if (id == COMMAND_FREQUENCY) frequency(value[0]);
+		else if (id == COMMAND_AMPLITUDE) amplitude(value[0]);
+		else if (id == COMMAND_OFFSET) this->offset(value[0]);
+		else if (id == COMMAND_BEGIN) begin(value[0]);
+	}
+	virtual void sample_rate_changed(void) { frequency(frequency_hz); }
+	float frequency_hz = 0;
+	float phase;			// 0 to 1
+	float increment;		// per block
+	float magnitude;
+	float level;
+	short shape;
+};
+
+// Attack, decay, sustain, release, with straight lines between the
+// values of each block
+class AudioSynthControlEnvelope : public AudioStream
+{
+public:
+	AudioSynthControlEnvelope() : AudioStream(0, NULL, "AudioSynthControlEnvelope"),
+		state(STATE_IDLE), level(0) {
+		attack(10.0f);
+		decay(35.0f);
+		sustain(0.5f);
+		release(300.0f);
+		initialised = true;
+	}
+	virtual void update(void);
+	void noteOn(void) {
+		if (post(COMMAND_NOTE_ON)) return;
+		state = STATE_ATTACK;
+	}
+	void noteOff(void) {
+		if (post(COMMAND_NOTE_OFF)) return;
+		if (state != STATE_IDLE) state = STATE_RELEASE;
+	}
+	void attack(float milliseconds) { set_time(COMMAND_ATTACK, milliseconds); }
+	void decay(float milliseconds) { set_time(COMMAND_DECAY, milliseconds); }
+	void release(float milliseconds) { set_time(COMMAND_RELEASE, milliseconds); }
+	void sustain(float n) {
+		if (n < 0.0f) n = 0.0f;
+		else if (n > 1.0f) n = 1.0f;
+		if (post(COMMAND_SUSTAIN, n)) return;
+		sustain_level = n;
+	}
+	bool isActive(void) { return *(volatile uint8_t *)&state != STATE_IDLE; }
+private:
+	enum { STATE_IDLE, STATE_ATTACK, STATE_DECAY, STATE_SUSTAIN, STATE_RELEASE };
+	enum { COMMAND_NOTE_ON, COMMAND_NOTE_OFF, COMMAND_ATTACK, COMMAND_DECAY,
+	       COMMAND_RELEASE, COMMAND_SUSTAIN };
+	virtual void command(uint8_t id, const float *value, unsigned int offset) {
+		if (id == COMMAND_NOTE_ON) noteOn();
+		else if (id == COMMAND_NOTE_OFF) noteOff();
+		else if (id == COMMAND_SUSTAIN) sustain(value[0]);
+		else set_time(id, value[0]);
+	}
+	// the time of a stage in ms, kept as the change of level per block
+	void set_time(uint8_t id, float milliseconds) {
+		if (milliseconds < 0.0f) milliseconds = 0.0f;
+		if (post(id, milliseconds)) return;
+		float blocks = milliseconds * sample_rate / (1000.0f * AUDIO_BLOCK_SAMPLES);
+		float step = (blocks > 1.0f) ? 1.0f / blocks : 1.0f;
+		if (id == COMMAND_ATTACK) { attack_ms = milliseconds; attack_step = step; }
+		else if (id == COMMAND_DECAY) { decay_ms = milliseconds; decay_step = step; }
+		else if (id == COMMAND_RELEASE) { release_ms = milliseconds; release_step = step; }
+	}
+	virtual void sample_rate_changed(void) {
+		set_time(COMMAND_ATTACK, attack_ms);
+		set_time(COMMAND_DECAY, decay_ms);
+		set_time(COMMAND_RELEASE, release_ms);
+	}
+	uint8_t state;
+	float level;
+	float sustain_level;
+	float attack_step, decay_step, release_step;	// of the level, per block
+	float attack_ms, decay_ms, release_ms;
+};
+
+#endif
@@ -37,9 +37,10 @@ class AudioSynthWaveformSine : public AudioStream
 public:
 	AudioSynthWaveformSine() : AudioStream(0, NULL, "AudioSynthWaveformSine"), magnitude(1.0) { initialised = true; }
 	void frequency(float freq) {
+		frequency_hz = freq;
 		if (freq < 0.0) freq = 0.0;
-		else if (freq > AUDIO_SAMPLE_RATE_EXACT/2.f) freq = AUDIO_SAMPLE_RATE_EXACT/2.f;
-		phase_increment = freq * (256.0 / AUDIO_SAMPLE_RATE_EXACT);
+		else if (freq > sample_rate/2.f) freq = sample_rate/2.f;
+		phase_increment = freq * (256.0 / sample_rate);
 	}
 	void phase(float angle) {
 		if (angle < 0.0f) angle = 0.0f;
@@ -57,6 +58,8 @@ public:
 	virtual void update(void);
 	
 private:
+	virtual void sample_rate_changed(void) { frequency(frequency_hz); }
+	float frequency_hz = 0;
 	float phase_accumulator;
 	float phase_increment;
 	float magnitude;
@@ -70,9 +73,10 @@ public:
 	// input = +1.0 doubles carrier
 	// input = -1.0 DC output
 	void frequency(float freq) {
+		frequency_hz = freq;
 		if (freq < 0.0) freq = 0.0;
-		else if (freq > AUDIO_SAMPLE_RATE_EXACT/4) freq = AUDIO_SAMPLE_RATE_EXACT/4;
-		phase_increment = freq * (4294967296.0 / AUDIO_SAMPLE_RATE_EXACT);
+		else if (freq > sample_rate/4) freq = sample_rate/4;
+		phase_increment = freq * (4294967296.0 / sample_rate);
 	}
 	void phase(float angle) {
 		if (angle < 0.0) angle = 0.0;
@@ -89,6 +93,8 @@ public:
 	}
 	virtual void update(void);
 private:
+	virtual void sample_rate_changed(void) { frequency(frequency_hz); }
+	float frequency_hz = 0;
 	uint32_t phase_accumulator;
 	uint32_t phase_increment;
 	audio_block_t *inputQueueArray[1];
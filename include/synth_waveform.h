@@ -29,6 +29,7 @@
 
 #include <Arduino.h>
 #include "AudioStream.h"
+#include "AudioBlockEvents.h"
 
 // src/data_waveforms.c
 extern "C" {
@@ -55,12 +56,14 @@ public:
 	}
 
 	void frequency(float freq) {
+		if (post(COMMAND_FREQUENCY, freq)) return;
+		frequency_hz = freq;
 		if (freq < 0.0) {
 			freq = 0.0;
-		} else if (freq > AUDIO_SAMPLE_RATE_EXACT / 2) {
-			freq = AUDIO_SAMPLE_RATE_EXACT / 2;
+		} else if (freq > sample_rate / 2) {
+			freq = sample_rate / 2;
 		}
-		phase_increment = freq * (1.0 / AUDIO_SAMPLE_RATE_EXACT);
+		phase_increment = freq * (1.0 / sample_rate);
 		//if (phase_increment > 0x7FFE0000u) phase_increment = 0x7FFE0000;
 		if (phase_increment > 0.5) phase_increment = 0.5; // FIXME
 	}
@@ -117,6 +120,15 @@ public:
 	virtual void update(void);
 
 private:
+	enum { COMMAND_FREQUENCY };
+	virtual void command(uint8_t id, const float *value, unsigned int offset) {
+		if (offset && events.add(id, value, offset)) return;
+		if (id == COMMAND_FREQUENCY) frequency(value[0]);
+	}
+	float render(float *bp, uint32_t n, float ph);
+	AudioBlockEvents events;
+	virtual void sample_rate_changed(void) { frequency(frequency_hz); }
+	float frequency_hz = 0;
 	float phase_accumulator;
 	float phase_increment;
 	float phase_offset;
@@ -138,12 +150,13 @@ public:
 	}
 
 	void frequency(float freq) {
+		frequency_hz = freq;
 		if (freq < 0.0) {
 			freq = 0.0;
-		} else if (freq > AUDIO_SAMPLE_RATE_EXACT / 2) {
-			freq = AUDIO_SAMPLE_RATE_EXACT / 2;
+		} else if (freq > sample_rate / 2) {
+			freq = sample_rate / 2;
 		}
-		phase_increment = freq * (4294967296.0 / AUDIO_SAMPLE_RATE_EXACT);
+		phase_increment = freq * (4294967296.0 / sample_rate);
 		if (phase_increment > 0x7FFE0000u) phase_increment = 0x7FFE0000;
 	}
 	void amplitude(float n) {	// 0 to 1.0
@@ -194,6 +207,8 @@ public:
 	virtual void update(void);
 
 private:
+	virtual void sample_rate_changed(void) { frequency(frequency_hz); }
+	float frequency_hz = 0;
 	audio_block_t *inputQueueArray[2];
 	float phase_accumulator;
 	float phase_increment;
@@ -29,84 +29,298 @@
  */
 
 #include "AudioStream.h"
+#include "AudioKernels.h"
 #include <stdio.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_task_wdt.h"
+#include "esp_heap_caps.h"
 #include "Arduino.h"
 
-#define MAX_AUDIO_MEMORY 163840
-#define NUM_MASKS  (((MAX_AUDIO_MEMORY / AUDIO_BLOCK_SAMPLES / 2) + 31) / 32)
+#ifndef F_CPU
+#define F_CPU (CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ * 1000000U)
+#endif
 
-audio_block_t * AudioStream::memory_pool;
-uint32_t AudioStream::memory_pool_available_mask[NUM_MASKS];
-uint16_t AudioStream::memory_pool_first_mask;
+AudioContext * AudioContext::current_context = NULL;
 
-//uint16_t AudioStream::cpu_cycles_total = 0;
-//uint16_t AudioStream::cpu_cycles_total_max = 0;
-uint16_t AudioStream::memory_used = 0;
-uint16_t AudioStream::memory_used_max = 0;
+AudioContext::AudioContext(void)
+{
+	memory_pool = NULL;
+	memory_psram_pool = NULL;
+	memory_size = 0;
+	memory_needed = 0;
+	memory_planned = NULL;
+	memory_pool_first_mask[MEMORY_INTERNAL] = AUDIO_MEMORY_MASKS;
+	memory_pool_first_mask[MEMORY_PSRAM] = AUDIO_MEMORY_PSRAM_MASKS;
+	for (int i=0; i < AUDIO_MEMORY_MASKS; i++) {
+		memory_pool_available_mask[i] = 0;
+	}
+	for (int i=0; i < AUDIO_MEMORY_PSRAM_MASKS; i++) {
+		memory_psram_available_mask[i] = 0;
+	}
+	memory_used = 0;
+	memory_used_max = 0;
+	for (int i=0; i < MEMORY_TIERS; i++) {
+		memory_tier_used[i] = 0;
+		memory_tier_used_max[i] = 0;
+		memory_tier_size[i] = 0;
+	}
+	clocksOverhead = 0;
+	clocksOverheadMax = 0;
+	sample_rate = AUDIO_SAMPLE_RATE_EXACT;
+	updates_per_second = AUDIO_SAMPLE_RATE_EXACT / AUDIO_BLOCK_SAMPLES;
+	update_per_second_counter = 0;
+	update_second_elapsed = false;
+	update_stream_clocks[0] = update_stream_clocks[1] = 0;
+	update_work_clocks[0] = update_work_clocks[1] = 0;
+	blockClocks = 0;
+	blockClocksMax = 0;
+	overruns = 0;
+	degrade = NULL;
+	degrade_calm = 0;
+	degradeLevel = AudioStream::DEGRADE_NONE;
+	set_deadline(0.9f);
+#if AUDIO_TRACE
+	trace_count = 0;
+	trace_on = true;
+	trace_stop_on_overrun = false;
+#endif
+	first_update = NULL;
+	first_stream = NULL;
+	blockingObjectRunning = false;
+	update_order_dirty = false;
+	update_caller_core = -1;
+	update_worker_core = -1;
+	update_split = false;
+	update_caller_task = NULL;
+	update_worker_task = NULL;
+	patch_head = 0;
+	patch_committed = 0;
+	patch_applied = 0;
+	patch_open = false;
+	first_fade = NULL;
+	command_head = 0;
+	command_tail = 0;
+	post_time = 0;
+	post_timed = false;
+	sample_clock = 0;
+}
 
-// Set up the pool of audio data blocks
+AudioContext::~AudioContext()
+{
+	if (memory_planned) heap_caps_free(memory_planned);
+	if (current_context == this) current_context = NULL;
+}
+
+// Constructed on first use, so objects created before main() can join it
+AudioContext & AudioContext::global(void)
+{
+	static AudioContext context;
+	return context;
+}
+
+AudioContext & AudioContext::current(void)
+{
+	return current_context ? *current_context : global();
+}
+
+void AudioContext::add(AudioStream *stream)
+{
+	stream->next_stream = NULL;
+	stream->sample_rate = sample_rate;
+	if (patch(PATCH_ADD, stream)) return;
+	add_now(stream);
+}
+
+void AudioContext::remove(AudioStream *stream)
+{
+	uint32_t seq = patch(PATCH_REMOVE, stream);
+	if (seq) patch_wait(seq);
+	else remove_now(stream);
+}
+
+void AudioContext::add_now(AudioStream *stream)
+{
+	if (first_stream == NULL) {
+		first_stream = stream;
+	} else {
+		AudioStream *p;
+		for (p=first_stream; p->next_stream; p = p->next_stream) ;
+		p->next_stream = stream;
+	}
+	if (stream->blocking) blockingObjectRunning = true;
+	update_order_dirty = true;
+}
+
+void AudioContext::remove_now(AudioStream *stream)
+{
+	AudioStream **p;
+
+	for (p = &first_stream; *p; p = &(*p)->next_stream) {
+		if (*p == stream) {
+			*p = stream->next_stream;
+			break;
+		}
+	}
+	for (p = &first_update; *p; p = &(*p)->next_update) {
+		if (*p == stream) {
+			*p = stream->next_update;
+			break;
+		}
+	}
+	blockingObjectRunning = false;
+	for (AudioStream *q = first_stream; q; q = q->next_stream) {
+		if (q->blocking) blockingObjectRunning = true;
+	}
+	// forget changes still waiting for their time
+	uint32_t head = __atomic_load_n(&command_head, __ATOMIC_ACQUIRE);
+	for (uint32_t i = command_tail; i != head; i++) {
+		command_op &op = command_queue[i % AUDIO_COMMAND_QUEUE];
+		if (op.target == stream) op.target = NULL;
+	}
+	update_order_dirty = true;
+}
+
+void AudioStream::end(void)
+{
+	if (ended) return;
+	ended = true;
+	context->remove(this);
+}
+
+bool AudioStream::setContext(AudioContext &ctx)
+{
+	if (&ctx == context) return true;
+	if (numConnections || ended) return false;
+	context->remove(this);
+	ctx.add(this);
+	context = &ctx;
+	sample_rate_changed();
+	return true;
+}
+
+// The pool is lock free, so blocks can be allocated and released
+// from any task on either core.  Each mask word is claimed with a
+// compare-and-swap, and memory_pool_first_mask is only a hint of
+// the first word that may have free blocks: it is never left above
+// a word that has a free block.  Each tier has its own masks and
+// hint; the used counts are kept per tier and for both together.
+
+// Set up the pool of audio data blocks of one tier,
 // placing them all onto the free list
-void AudioStream::initialize_memory(audio_block_t *data, unsigned int num)
+void AudioContext::initialize_memory(audio_block_t *data, unsigned int num, uint8_t tier)
 {
 	unsigned int i;
-	unsigned int maxnum = MAX_AUDIO_MEMORY / AUDIO_BLOCK_SAMPLES / 2;
+	unsigned int maxnum, masks;
+	uint32_t *mask;
 
+	if (tier == MEMORY_PSRAM) {
+		maxnum = AUDIO_MEMORY_PSRAM_MAX;
+		masks = AUDIO_MEMORY_PSRAM_MASKS;
+		mask = memory_psram_available_mask;
+		memory_psram_pool = data;
+	} else {
+		tier = MEMORY_INTERNAL;
+		maxnum = MAX_AUDIO_MEMORY / AUDIO_BLOCK_SAMPLES / 2;
+		masks = AUDIO_MEMORY_MASKS;
+		mask = memory_pool_available_mask;
+		memory_pool = data;
+	}
 	if (num > maxnum) num = maxnum;
-	memory_pool = data;
-	memory_pool_first_mask = 0;
-	for (i=0; i < NUM_MASKS; i++) {
-		memory_pool_available_mask[i] = 0;
+	memory_tier_size[tier] = num;
+	memory_size = memory_tier_size[MEMORY_INTERNAL] + memory_tier_size[MEMORY_PSRAM];
+	memory_pool_first_mask[tier] = 0;
+	for (i=0; i < masks; i++) {
+		mask[i] = 0;
 	}
 	for (i=0; i < num; i++) {
-		memory_pool_available_mask[i >> 5] |= (1 << (i & 0x1F));
+		mask[i >> 5] |= (1 << (i & 0x1F));
 	}
 	for (i=0; i < num; i++) {
 		data[i].memory_pool_index = i;
+		data[i].memory_pool_tier = tier;
 	}
-	//__disable_irq();
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+// Lower the first mask hint to index, unless it is already lower
+static inline void memory_pool_lower_first_mask(uint32_t *first, uint32_t index)
+{
+	uint32_t current = __atomic_load_n(first, __ATOMIC_SEQ_CST);
+	while (index < current) {
+		if (__atomic_compare_exchange_n(first, &current, index, true,
+				__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) break;
+	}
+}
+
+// Count one more block in use, and raise the peak with it
+static inline void memory_count_used(uint32_t *used_count, uint32_t *max_count)
+{
+	uint32_t used = __atomic_add_fetch(used_count, 1, __ATOMIC_RELAXED);
+	uint32_t max = __atomic_load_n(max_count, __ATOMIC_RELAXED);
+	while (used > max) {
+		if (__atomic_compare_exchange_n(max_count, &max, used, true,
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED)) break;
+	}
+}
 
+// Allocate 1 audio data block, from the tier asked for when it has
+// one, else from the other.  If successful the caller is the only
+// owner of this new block
+audio_block_t * AudioContext::allocate(uint8_t tier)
+{
+	audio_block_t *block = allocate_in(tier);
+	if (block) return block;
+	return allocate_in(tier == MEMORY_PSRAM ? MEMORY_INTERNAL : MEMORY_PSRAM);
 }
 
-// Allocate 1 audio data block.  If successful
-// the caller is the only owner of this new block
-audio_block_t * AudioStream::allocate(void)
+// Allocate 1 audio data block from one tier only
+audio_block_t * AudioContext::allocate_in(uint8_t tier)
 {
-	uint32_t n, index, avail;
-	uint32_t *p, *end;
+	uint32_t n, index, avail, bit;
 	audio_block_t *block;
-	uint32_t used;
+	uint32_t *mask, masks, *first;
 
-	p = memory_pool_available_mask;
-	end = p + NUM_MASKS;
-	//__disable_irq();
-	index = memory_pool_first_mask;
-	p += index;
-	while (1) {
-		if (p >= end) {
-			//__disable_irq();
-			//Serial.println("alloc:null");
-			return NULL;
-		}
-		avail = *p;
-		if (avail) break;
-		index++;
-		p++;
-	}
-	n = __builtin_clz(avail);
-	avail &= ~(0x80000000 >> n);
-	*p = avail;
-	if (!avail) index++;
-	memory_pool_first_mask = index;
-	used = memory_used + 1;
-	memory_used = used;
-	//__disable_irq();
-	index = p - memory_pool_available_mask;
-	block = memory_pool + ((index << 5) + (31 - n));
-	block->ref_count = 1;
-	if (used > memory_used_max) memory_used_max = used;
+	if (tier == MEMORY_PSRAM) {
+		mask = memory_psram_available_mask;
+		masks = AUDIO_MEMORY_PSRAM_MASKS;
+	} else {
+		tier = MEMORY_INTERNAL;
+		mask = memory_pool_available_mask;
+		masks = AUDIO_MEMORY_MASKS;
+	}
+	first = &memory_pool_first_mask[tier];
+	index = __atomic_load_n(first, __ATOMIC_SEQ_CST);
+	for (; index < masks; index++) {
+		avail = __atomic_load_n(&mask[index], __ATOMIC_SEQ_CST);
+		while (avail) {
+			n = __builtin_clz(avail);
+			bit = 0x80000000 >> n;
+			// on failure avail is reloaded with the current mask
+			if (__atomic_compare_exchange_n(&mask[index], &avail,
+					avail & ~bit, true, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+				goto claimed;
+			}
+		}
+	}
+	//Serial.println("alloc:null");
+	return NULL;
+
+claimed:
+	if (avail == bit) {
+		// this word is empty now, move the hint past it, then
+		// undo that if a block was released into it meanwhile
+		uint32_t expected = index;
+		__atomic_compare_exchange_n(first, &expected, index + 1,
+			false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&mask[index], __ATOMIC_SEQ_CST)) {
+			memory_pool_lower_first_mask(first, index);
+		}
+	}
+	memory_count_used(&memory_used, &memory_used_max);
+	memory_count_used(&memory_tier_used[tier], &memory_tier_used_max[tier]);
+	block = (tier == MEMORY_PSRAM ? memory_psram_pool : memory_pool) + ((index << 5) + (31 - n));
+	__atomic_store_n(&block->ref_count, 1, __ATOMIC_RELAXED);
 	//Serial.print("alloc:");
 	//Serial.println((uint32_t)block, HEX);
 	return block;
@@ -115,23 +329,26 @@ audio_block_t * AudioStream::allocate(void)
 // Release ownership of a data block.  If no
 // other streams have ownership, the block is
 // returned to the free pool
-void AudioStream::release(audio_block_t *block)
+void AudioContext::release(audio_block_t *block)
 {
 	//if (block == NULL) return;
 	uint32_t mask = (0x80000000 >> (31 - (block->memory_pool_index & 0x1F)));
 	uint32_t index = block->memory_pool_index >> 5;
+	uint32_t tier = block->memory_pool_tier;
 
-	//__disable_irq();
-	if (block->ref_count > 1) {
-		block->ref_count--;
-	} else {
+	if (__atomic_sub_fetch(&block->ref_count, 1, __ATOMIC_ACQ_REL) == 0) {
 		//Serial.print("reles:");
 		//Serial.println((uint32_t)block, HEX);
-		memory_pool_available_mask[index] |= mask;
-		if (index < memory_pool_first_mask) memory_pool_first_mask = index;
-		memory_used--;
+		// uncounted first, so the peaks never pass the pool size
+		__atomic_sub_fetch(&memory_tier_used[tier], 1, __ATOMIC_RELAXED);
+		__atomic_sub_fetch(&memory_used, 1, __ATOMIC_RELAXED);
+		if (tier == MEMORY_PSRAM) {
+			__atomic_fetch_or(&memory_psram_available_mask[index], mask, __ATOMIC_SEQ_CST);
+		} else {
+			__atomic_fetch_or(&memory_pool_available_mask[index], mask, __ATOMIC_SEQ_CST);
+		}
+		memory_pool_lower_first_mask(&memory_pool_first_mask[tier], index);
 	}
-	//__disable_irq();
 }
 
 // Transmit an audio data block
@@ -144,15 +361,50 @@ void AudioStream::release(audio_block_t *block)
 void AudioStream::transmit(audio_block_t *block, unsigned char index)
 {
 	for (AudioConnection *c = destination_list; c != NULL; c = c->next_dest) {
-		if (c->src_index == index) {
+		if (c->src_index == index && !c->control) {
 			if (c->dst.inputQueue[c->dest_index] == NULL) {
+				if (c->fade != AudioConnection::FADE_NONE) {
+					// a connection just made or removed gets its own ramped copy
+					audio_block_t *faded = allocate();
+					if (faded) {
+						float step = 1.0f / AUDIO_BLOCK_SAMPLES;
+						if (c->fade == AudioConnection::FADE_IN) {
+							audio_scale_line(faded->data, block->data, 0.0f, step);
+						} else {
+							audio_scale_line(faded->data, block->data, 1.0f, -step);
+						}
+						c->dst.inputQueue[c->dest_index] = faded;
+						continue;
+					}
+				}
 				c->dst.inputQueue[c->dest_index] = block;
-				block->ref_count++;
+				__atomic_add_fetch(&block->ref_count, 1, __ATOMIC_RELAXED);
 			}
 		}
 	}
 }
 
+void AudioStream::transmitControl(float value, unsigned char index)
+{
+	for (AudioConnection *c = destination_list; c != NULL; c = c->next_dest) {
+		if (c->src_index == index && c->control) {
+			audio_control_t &in = c->dst.controlQueue[c->dest_index];
+			in.start = in.started ? in.end : value;
+			in.end = value;
+			in.started = true;
+			in.fresh = true;
+		}
+	}
+}
+
+bool AudioStream::receiveControl(unsigned int index, float &start, float &end)
+{
+	if (index >= num_controls || !controlQueue[index].fresh) return false;
+	controlQueue[index].fresh = false;
+	start = controlQueue[index].start;
+	end = controlQueue[index].end;
+	return true;
+}
 
 // Receive block from an input.  The block's data
 // may be shared with other streams, so it must not be written
@@ -175,29 +427,73 @@ audio_block_t * AudioStream::receiveWritable(unsigned int index)
 	if (index >= num_inputs) return NULL;
 	in = inputQueue[index];
 	inputQueue[index] = NULL;
-	if (in && in->ref_count > 1) {
+	if (in && __atomic_load_n(&in->ref_count, __ATOMIC_ACQUIRE) > 1) {
 		p = allocate();
-		if (p) memcpy(p->data, in->data, sizeof(p->data));
-		in->ref_count--;
+		if (p) audio_copy(p->data, in->data);
+		release(in);
 		in = p;
 	}
 	return in;
 }
 
+// Receive block from an input, to keep past this update.  A block in
+// the other tier is copied into this object's memory_tier, so a delay
+// line fills PSRAM and leaves internal RAM to the blocks in flight.
+audio_block_t * AudioStream::receiveHeld(unsigned int index)
+{
+	audio_block_t *in, *p;
+
+	in = receiveReadOnly(index);
+	if (in && in->memory_pool_tier != memory_tier) {
+		p = context->allocate_in(memory_tier);
+		if (p) {
+			audio_copy(p->data, in->data);
+			release(in);
+			in = p;
+		}
+	}
+	return in;
+}
+
 
 void AudioConnection::connect(void)
+{
+	if (src.context != dst.context) return;	// each graph has its own pool and update_all
+	if (src.context->patch(AudioContext::PATCH_CONNECT, this)) return;
+	link();
+}
+
+void AudioConnection::disconnect(void)
+{
+	if (src.context->patch(AudioContext::PATCH_DISCONNECT, this)) return;
+	unlink();
+}
+
+AudioConnection::~AudioConnection()
+{
+	uint32_t seq = src.context->patch(AudioContext::PATCH_DISCONNECT, this);
+	if (seq) {
+		// the audio task must be done with this connection, fade and all
+		src.context->patch_wait(seq);
+		while (__atomic_load_n(&isConnected, __ATOMIC_ACQUIRE)) vTaskDelay(1);
+	} else {
+		unlink();
+	}
+}
+
+void AudioConnection::link(void)
 {
 	AudioConnection *p;
 
 	if (isConnected) return;
-	if (dest_index > dst.num_inputs) return;
+	if (control ? dest_index >= dst.num_controls : dest_index > dst.num_inputs) return;
 	//__disable_irq();
 	p = src.destination_list;
 	if (p == NULL) {
 		src.destination_list = this;
 	} else {
 		while (p->next_dest) {
-			if (&p->src == &this->src && &p->dst == &this->dst
+			if (&p->src == &this->src && &p->dst == &this->dst && p->control == this->control
 				&& p->src_index == this->src_index && p->dest_index == this->dest_index) {
 				//Source and destination already connected through another connection, abort
 				//__disable_irq();
@@ -215,43 +511,36 @@ void AudioConnection::connect(void)
 	dst.active = true;
 
 	isConnected = true;
+	src.context->update_order_dirty = true;
 
 	//__disable_irq();
 }
 
-void AudioConnection::disconnect(void)
+void AudioConnection::unlink(void)
 {
 	AudioConnection *p;
 
 	if (!isConnected) return;
-	if (dest_index > dst.num_inputs) return;
+	if (control ? dest_index >= dst.num_controls : dest_index > dst.num_inputs) return;
 	//__disable_irq();
 	// Remove destination from source list
 	p = src.destination_list;
-	if (p == NULL) {
-		return;
-	} else if (p == this) {
-		if (p->next_dest) {
-			src.destination_list = next_dest;
-		} else {
-			src.destination_list = NULL;
-		}
+	if (p == this) {
+		src.destination_list = next_dest;
 	} else {
-		while (p) {
-			if (p == this) {
-				if (p->next_dest) {
-					p = next_dest;
-					break;
-				} else {
-					p = NULL;
-					break;
-				}
-			}
-			p = p->next_dest;
-		}
+		while (p && p->next_dest != this) p = p->next_dest;
+		if (p == NULL) return;
+		p->next_dest = next_dest;
+	}
+	next_dest = NULL;
+	//Release possible pending src block from destination
+	if (control) {
+		dst.controlQueue[dest_index].fresh = false;
+		dst.controlQueue[dest_index].started = false;
+	} else if (dst.inputQueue[dest_index]) {
+		dst.release(dst.inputQueue[dest_index]);
+		dst.inputQueue[dest_index] = NULL;
 	}
-	//Remove possible pending src block from destination
-	dst.inputQueue[dest_index] = NULL;
 
 	//Check if the disconnected AudioStream objects should still be active
 	src.numConnections--;
@@ -264,59 +553,698 @@ void AudioConnection::disconnect(void)
 		dst.active = false;
 	}
 
-	isConnected = false;
+	feedback = false;
+	fade = FADE_NONE;
+	src.context->update_order_dirty = true;
+	__atomic_store_n(&isConnected, false, __ATOMIC_RELEASE);
 
 	//__disable_irq();
 }
 
-bool AudioStream::blockingObjectRunning = false;
+// True when update_all runs, on another task than the caller
+bool AudioContext::audio_task_elsewhere(void)
+{
+	void *audio_task = __atomic_load_n(&update_caller_task, __ATOMIC_ACQUIRE);
+	return audio_task != NULL && xTaskGetCurrentTaskHandle() != audio_task;
+}
+
+// Queue a parameter change for the audio task.  Like graph changes, only
+// one task should make them while update_all runs.
+bool AudioContext::post(AudioStream *target, uint8_t id, float a, float b, float c)
+{
+	if (!audio_task_elsewhere()) return false;
+	while (command_head - __atomic_load_n(&command_tail, __ATOMIC_ACQUIRE) >= AUDIO_COMMAND_QUEUE) {
+		vTaskDelay(1);
+	}
+	command_op &op = command_queue[command_head % AUDIO_COMMAND_QUEUE];
+	op.target = target;
+	op.id = id;
+	op.timed = post_timed;
+	op.time = post_time;
+	op.value[0] = a;
+	op.value[1] = b;
+	op.value[2] = c;
+	__atomic_store_n(&command_head, command_head + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+// Hand the queued parameter changes to their objects, in order, up to
+// the first one timed for a later block
+void AudioContext::command_apply(void)
+{
+	uint32_t head = __atomic_load_n(&command_head, __ATOMIC_ACQUIRE);
+
+	while (command_tail != head) {
+		command_op &op = command_queue[command_tail % AUDIO_COMMAND_QUEUE];
+		unsigned int offset = 0;
+		if (op.timed) {
+			int32_t ahead = (int32_t)(op.time - sample_clock);
+			if (ahead >= AUDIO_BLOCK_SAMPLES) break;
+			if (ahead > 0) offset = ahead;	// late ones at the block's start
+		}
+		if (op.target) op.target->command(op.id, op.value, offset);
+		__atomic_store_n(&command_tail, command_tail + 1, __ATOMIC_RELEASE);
+	}
+}
+
+// Graph changes from another task than the one running update_all are
+// queued, and the audio task makes them at the start of its next
+// update_all.  Only one task should change a running graph at a time.
+// Returns the number to wait for with patch_wait(), or 0 when the
+// change can be made right away.
+uint32_t AudioContext::patch(uint8_t type, void *target)
+{
+	if (!audio_task_elsewhere()) return 0;
+	while (patch_head - __atomic_load_n(&patch_applied, __ATOMIC_ACQUIRE) >= AUDIO_PATCH_QUEUE) {
+		// full: a patch this large can't be made in one go
+		commit_patch();
+		vTaskDelay(1);
+	}
+	patch_queue[patch_head % AUDIO_PATCH_QUEUE].type = type;
+	patch_queue[patch_head % AUDIO_PATCH_QUEUE].target = target;
+	patch_head++;
+	if (!patch_open) commit_patch();
+	return patch_head;
+}
 
-AudioStream * AudioStream::first_update = NULL;
-const int updatesPerSecond = AUDIO_SAMPLE_RATE_EXACT / AUDIO_BLOCK_SAMPLES;
-int updatePerSecondCounter = 0;
+void AudioContext::commit_patch(void)
+{
+	patch_open = false;
+	__atomic_store_n(&patch_committed, patch_head, __ATOMIC_RELEASE);
+}
+
+// Wait for the audio task to make a queued change
+void AudioContext::patch_wait(uint32_t seq)
+{
+	commit_patch();
+	while ((int32_t)(__atomic_load_n(&patch_applied, __ATOMIC_ACQUIRE) - seq) < 0) vTaskDelay(1);
+}
 
-void AudioStream::update_all(void) // AudioStream::update_all()
+// At the block boundary, end the fades of the last block and make the
+// committed changes.  New connections fade in and removed ones fade out
+// over the next block, so the change doesn't click.
+void AudioContext::patch_apply(void)
+{
+	AudioConnection *c, *next;
+	uint32_t committed = __atomic_load_n(&patch_committed, __ATOMIC_ACQUIRE);
+
+	for (c = first_fade; c; c = next) {
+		next = c->next_fade;
+		if (c->fade == AudioConnection::FADE_OUT) {
+			c->unlink();	// the task deleting it may free it from here on
+		} else {
+			c->fade = AudioConnection::FADE_NONE;
+		}
+	}
+	first_fade = NULL;
+	while (patch_applied != committed) {
+		patch_op &op = patch_queue[patch_applied % AUDIO_PATCH_QUEUE];
+		c = (AudioConnection *)op.target;
+		switch (op.type) {
+		case PATCH_CONNECT:
+			if (c->isConnected) break;
+			c->link();
+			if (!c->isConnected) break;
+			c->fade = AudioConnection::FADE_IN;
+			c->next_fade = first_fade;
+			first_fade = c;
+			break;
+		case PATCH_DISCONNECT:
+			if (!c->isConnected || c->fade == AudioConnection::FADE_OUT) break;
+			if (c->fade == AudioConnection::FADE_NONE) {
+				c->next_fade = first_fade;
+				first_fade = c;
+			}
+			c->fade = AudioConnection::FADE_OUT;
+			break;
+		case PATCH_ADD:
+			add_now((AudioStream *)op.target);
+			break;
+		case PATCH_REMOVE:
+			remove_now((AudioStream *)op.target);
+			break;
+		}
+		__atomic_store_n(&patch_applied, patch_applied + 1, __ATOMIC_RELEASE);
+	}
+}
+
+// True when the stream can start a feedback loop among the streams not
+// yet scheduled: it feeds itself through the others, and every stream
+// that still has to run before it is on the loop too.  Starting there,
+// only connections that close the loop get the 1 block delay.
+bool AudioContext::update_loop_start(AudioStream *stream)
 {
 	AudioStream *p;
-	//portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
-	for (p = AudioStream::first_update; p; p = p->next_update) {
-		if (p->active) {
-			if(p->blocking || !p->initialised){
-				p->update();
-				p->clocksPerUpdate = 0;
-				// esp_task_wdt_reset();
+	AudioConnection *c;
+	bool changed;
+
+	for (p = first_stream; p; p = p->next_stream) {
+		p->update_reached = false;
+		p->update_reaching = (p == stream);
+	}
+	do {
+		changed = false;
+		for (p = first_stream; p; p = p->next_stream) {
+			if (p->update_scheduled) continue;
+			for (c = p->destination_list; c != NULL; c = c->next_dest) {
+				AudioStream *q = &c->dst;
+				if (q == p || q->update_scheduled) continue;
+				// fed by the stream
+				if ((p == stream || p->update_reached) && !q->update_reached) {
+					q->update_reached = true;
+					changed = true;
+				}
+				// feeding it
+				if (q->update_reaching && !p->update_reaching) {
+					p->update_reaching = true;
+					changed = true;
+				}
+			}
+		}
+	} while (changed);
+	if (!stream->update_reached) return false;
+	for (p = first_stream; p; p = p->next_stream) {
+		if (!p->update_scheduled && p->update_reaching && !p->update_reached) return false;
+	}
+	return true;
+}
+
+// Sort the update_all list so every stream runs after the streams
+// feeding it, and data passes through the whole graph in one update.
+// Ties keep the order of creation.  When only feedback loops remain, the
+// first created stream that can start one is run anyway; the connections
+// that close the loop into it then carry data with a 1 block delay.
+void AudioContext::update_order(void)
+{
+	AudioStream *p, *last = NULL;
+	AudioConnection *c;
+	uint16_t index = 0;
+
+	update_order_dirty = false;
+	for (p = first_stream; p; p = p->next_stream) {
+		p->update_pending = 0;
+		p->update_scheduled = false;
+	}
+	for (p = first_stream; p; p = p->next_stream) {
+		for (c = p->destination_list; c != NULL; c = c->next_dest) {
+			if (&c->dst != p) c->dst.update_pending++;
+		}
+	}
+	first_update = NULL;
+	while (1) {
+		AudioStream *next = NULL, *loop = NULL;
+		for (p = first_stream; p; p = p->next_stream) {
+			if (p->update_scheduled) continue;
+			if (p->update_pending == 0) {
+				next = p;
+				break;
+			}
+			if (!loop) loop = p;
+		}
+		if (!next) {
+			for (p = first_stream; p; p = p->next_stream) {
+				if (!p->update_scheduled && update_loop_start(p)) {
+					loop = p;
+					break;
+				}
+			}
+			next = loop;
+		}
+		if (!next) break;
+		next->update_scheduled = true;
+		next->update_index = index++;
+		next->next_update = NULL;
+		if (last) {
+			last->next_update = next;
+		} else {
+			first_update = next;
+		}
+		last = next;
+		for (c = next->destination_list; c != NULL; c = c->next_dest) {
+			if (!c->dst.update_scheduled) c->dst.update_pending--;
+		}
+	}
+	for (p = first_stream; p; p = p->next_stream) {
+		for (c = p->destination_list; c != NULL; c = c->next_dest) {
+			c->feedback = (c->dst.update_index <= p->update_index);
+		}
+	}
+	update_fusion();
+	plan_memory();
+}
+
+// Find chains of objects that only scale and offset their one input,
+// each feeding only the next, eg. amp -> mixer with 1 input -> calibration.
+// The first of each chain then runs the whole chain in one pass; when it
+// can't, the rest of the chain still can.
+void AudioContext::update_fusion(void)
+{
+	AudioStream *p, *q;
+	AudioConnection *c;
+
+	// fusable streams with exactly one incoming connection
+	for (q = first_update; q; q = q->next_update) {
+		q->fuse_next = NULL;
+		q->fused = false;
+		q->fuse_input = AudioStream::FUSE_NONE;
+		if (!q->active || !q->fusable()) continue;
+		int inputs = 0;
+		for (p = first_update; p; p = p->next_update) {
+			for (c = p->destination_list; c != NULL; c = c->next_dest) {
+				if (&c->dst == q && inputs++ == 0) q->fuse_input = c->dest_index;
 			}
-			else{
-				//portENTER_CRITICAL(&mux);
-				uint32_t startTick = xthal_get_ccount();
-				p->update();
-				uint32_t finishTick = xthal_get_ccount();
-				//portEXIT_CRITICAL(&mux);
-					
-				if(finishTick > startTick)		//Ignore the wraparound boundary
-				{
-					p->clocksPerUpdate = (finishTick - startTick) - 11;			//11 is the minimum clocks to get the timer values
-					p->clocksPerSecondSum += p->clocksPerUpdate;
-					if(p->clocksPerUpdate > p->clocksPerUpdateMax)	
-						p->clocksPerUpdateMax = p->clocksPerUpdate;
-					if(p->clocksPerUpdate < p->clocksPerUpdateMin)
-						p->clocksPerUpdateMin = p->clocksPerUpdate;
-					if(updatePerSecondCounter == (updatesPerSecond - 1))
-					{
-						p->clocksPerUpdateMax = p->clocksPerUpdate;			//Reset max
-						p->clocksPerUpdateMin = p->clocksPerUpdate;			//Reset min
-						p->clocksPerSecond = p->clocksPerSecondSum;
-						p->clocksPerSecondSum = 0;							//Reset sum
+		}
+		if (inputs != 1) q->fuse_input = AudioStream::FUSE_NONE;
+	}
+	// link those that feed only one other such stream
+	for (p = first_update; p; p = p->next_update) {
+		if (p->fuse_input == AudioStream::FUSE_NONE) continue;
+		c = p->destination_list;
+		if (!c || c->next_dest || c->feedback || c->src_index != 0) continue;
+		if (&c->dst == p || c->dst.fuse_input == AudioStream::FUSE_NONE) continue;
+		p->fuse_next = &c->dst;
+	}
+}
+
+// Work out the most blocks the graph can have in use at once, from the
+// update_all order.  A transmitted block lives from the update of its
+// sender to the update of its last receiver, or on a feedback connection
+// until that receiver runs in the next update_all.  Blocks that streams
+// keep between updates, like delay lines, come on top.
+void AudioContext::plan_memory(void)
+{
+	AudioStream *p, *q;
+	AudioConnection *c, *d;
+	uint32_t held = 0, peak = 0;
+	int steps = 0;
+
+	for (p = first_update; p; p = p->next_update) {
+		// blocks kept in PSRAM leave the internal pool alone
+		if (p->active && (p->memory_tier == MEMORY_INTERNAL || !memory_tier_size[MEMORY_PSRAM])) {
+			held += p->blocks_held();
+		}
+		steps++;
+	}
+	for (int t = 0; t < steps; t++) {
+		uint32_t live = held;
+		for (p = first_update; p; p = p->next_update) {
+			for (c = p->destination_list; c != NULL; c = c->next_dest) {
+				if (c->control) continue;	// no blocks on those
+				// each output sends one block, however many connections it has
+				for (d = p->destination_list; d != c && (d->control || d->src_index != c->src_index); d = d->next_dest) ;
+				if (d != c) continue;
+				int last = p->update_index, wrap = -1;
+				for (d = c; d != NULL; d = d->next_dest) {
+					if (d->control || d->src_index != c->src_index) continue;
+					q = &d->dst;
+					if (d->feedback) {
+						if (q->update_index > wrap) wrap = q->update_index;
+					} else if (q->update_index > last) {
+						last = q->update_index;
 					}
 				}
-			}			
+				if (t >= p->update_index && (t <= last || wrap >= 0)) live++;
+				else if (t <= wrap) live++;
+			}
+		}
+		if (live > peak) peak = live;
+	}
+	memory_needed = peak;
+}
+
+// Size the pool to exactly what the graph needs, plus spare blocks, once
+// all the connections are made.  Call it again after adding objects or
+// connections, but not while update_all is running.
+bool AudioContext::initialize_planned_memory(unsigned int spare)
+{
+	if (update_order_dirty) update_order();
+	else plan_memory();
+	unsigned int num = memory_needed + spare;
+	if (num == 0) num = 1;
+	if (memory_planned) {
+		if (memory_tier_size[MEMORY_INTERNAL] >= num) return true;
+		heap_caps_free(memory_planned);
+	}
+	memory_planned = heap_caps_malloc(num * sizeof(audio_block_t) + AUDIO_BLOCK_ALIGN,
+		MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+	if (!memory_planned) return false;
+	initialize_memory(audio_block_align(memory_planned), num);
+	return true;
+}
+
+// Split the update_all list for two cores.  Blocking streams (I2S)
+// that only depend on other blocking streams run first, the remaining
+// blocking streams run last, on the calling task.  Everything between
+// is grouped into branches that share no connections, and each branch
+// goes to the core with the least work so far, heaviest branch first.
+// When a blocking stream feeds a non-blocking one in the same update,
+// the list can't be split and update_all runs everything in order.
+void AudioContext::update_partition(void)
+{
+	AudioStream *p, *q;
+	AudioConnection *c;
+	bool changed;
+
+	update_split = (update_worker_core >= 0 && update_worker_core != update_caller_core);
+	for (p = first_update; p; p = p->next_update) {
+		p->update_stage = p->blocking ? AudioStream::UPDATE_STAGE_FIRST : AudioStream::UPDATE_STAGE_BRANCH;
+		p->update_branch = p->update_index;
+		p->core = update_caller_core;
+	}
+	for (p = first_update; p; p = p->next_update) {
+		for (c = p->destination_list; c != NULL; c = c->next_dest) {
+			if (c->feedback) continue;
+			if (p->update_stage != AudioStream::UPDATE_STAGE_FIRST && c->dst.blocking) {
+				c->dst.update_stage = AudioStream::UPDATE_STAGE_LAST;
+			} else if (p->update_stage == AudioStream::UPDATE_STAGE_LAST && !c->dst.blocking) {
+				update_split = false;
+			}
+		}
+	}
+	if (!update_split) return;
+
+	// label each branch with the lowest update_index in it
+	do {
+		changed = false;
+		for (p = first_update; p; p = p->next_update) {
+			if (p->update_stage != AudioStream::UPDATE_STAGE_BRANCH) continue;
+			for (c = p->destination_list; c != NULL; c = c->next_dest) {
+				if (c->dst.update_stage != AudioStream::UPDATE_STAGE_BRANCH) continue;
+				if (c->dst.update_branch < p->update_branch) {
+					p->update_branch = c->dst.update_branch;
+					changed = true;
+				} else if (p->update_branch < c->dst.update_branch) {
+					c->dst.update_branch = p->update_branch;
+					changed = true;
+				}
+			}
+		}
+	} while (changed);
+
+	// total the clocks of each branch in its first stream
+	for (p = first_update; p; p = p->next_update) {
+		p->update_branch_clocks = 0;
+	}
+	for (p = first_update; p; p = p->next_update) {
+		if (p->update_stage != AudioStream::UPDATE_STAGE_BRANCH) continue;
+		for (q = first_update; q->update_index != p->update_branch; q = q->next_update) ;
+		q->update_branch_clocks += p->clocksPerSecond ? p->clocksPerSecond : 1;
+	}
+
+	uint32_t load[2] = {0, 0};
+	while (1) {
+		AudioStream *heaviest = NULL;
+		for (p = first_update; p; p = p->next_update) {
+			if (p->update_stage != AudioStream::UPDATE_STAGE_BRANCH) continue;
+			if (p->update_branch != p->update_index || p->update_branch_clocks == 0) continue;
+			if (!heaviest || p->update_branch_clocks > heaviest->update_branch_clocks) heaviest = p;
+		}
+		if (!heaviest) break;
+		int side = (load[1] < load[0]) ? 1 : 0;
+		load[side] += heaviest->update_branch_clocks;
+		heaviest->update_branch_clocks = 0;
+		for (p = heaviest; p; p = p->next_update) {
+			if (p->update_stage == AudioStream::UPDATE_STAGE_BRANCH && p->update_branch == heaviest->update_index) {
+				p->core = side ? update_worker_core : update_caller_core;
+			}
+		}
+	}
+}
+
+// The clocks a block may take, as a fraction of its period at the
+// sample rate, leaving the rest for I2S and other tasks on the core
+void AudioContext::set_deadline(float fraction)
+{
+	deadline_fraction = fraction;
+	deadlineClocks = (uint32_t)(fraction * ((float)F_CPU / sample_rate) * AUDIO_BLOCK_SAMPLES);
+}
+
+void AudioContext::set_degrade_level(uint8_t level)
+{
+	degradeLevel = level;
+	for (AudioStream *p = first_stream; p; p = p->next_stream) {
+		if (p->optional) p->degraded = level;
+	}
+}
+
+void AudioContext::degrade_optional(AudioContext &context, bool overrun)
+{
+	if (overrun) {
+		context.degrade_calm = 0;
+		if (context.degradeLevel < AudioStream::DEGRADE_BYPASS) {
+			context.set_degrade_level(context.degradeLevel + 1);
+		}
+	} else if (context.blockClocks > context.deadlineClocks / 4 * 3) {
+		context.degrade_calm = 0;
+	} else if (context.degradeLevel > AudioStream::DEGRADE_NONE &&
+			++context.degrade_calm >= (uint32_t)context.updates_per_second) {
+		context.degrade_calm = 0;
+		context.set_degrade_level(context.degradeLevel - 1);
+	}
+}
+
+// Change the sample rate of the whole graph.  Call this before
+// starting I2S, so the codec is clocked at the same rate.
+void AudioContext::set_sample_rate(float rate)
+{
+	if (rate <= 0.0f) return;
+	sample_rate = rate;
+	updates_per_second = (int)(rate / AUDIO_BLOCK_SAMPLES);
+	if (update_per_second_counter >= updates_per_second) update_per_second_counter = 0;
+	set_deadline(deadline_fraction);
+	for (AudioStream *p = first_stream; p; p = p->next_stream) {
+		p->sample_rate = rate;
+		p->sample_rate_changed();
+	}
+}
+
+// Run the chain this stream heads as one multiply-add over the block.
+// Returns false, to update each of them as usual, when one of them
+// isn't a plain scale and offset at the moment.
+bool AudioStream::update_fused(void)
+{
+	audio_block_t *block;
+	AudioStream *p, *tail = this;
+	float scale = 1.0f, offset = 0.0f, s, o;
+
+	for (p = this; p; p = p->fuse_next) {
+		tail = p;
+		if (p->degraded == DEGRADE_BYPASS) continue;
+		if (!p->affine(p->fuse_input, s, o)) return false;
+		scale *= s;
+		offset = offset * s + o;
+	}
+	for (p = fuse_next; p; p = p->fuse_next) {
+		p->fused = true;
+	}
+	if (scale == 1.0f && offset == 0.0f) {
+		// pass input to output without any change
+		block = receiveReadOnly(fuse_input);
+		if (block) {
+			tail->transmit(block);
+			release(block);
+		}
+	} else if (scale == 0.0f && offset == 0.0f) {
+		// silence, discard any input and transmit nothing
+		block = receiveReadOnly(fuse_input);
+		if (block) release(block);
+	} else {
+		block = receiveWritable(fuse_input);
+		if (!block && offset != 0.0f) {
+			// silence in, which is no block, is still the offset out
+			block = allocate();
+			if (block) audio_fill(block->data, 0.0f);
+		}
+		if (block) {
+			audio_affine(block->data, block->data, scale, offset);
+			tail->transmit(block);
+			release(block);
+		}
+	}
+	return true;
+}
+
+// An optional stream bypassed under load: input 0 goes straight to
+// output 0, the other inputs are dropped
+void AudioStream::update_bypass(void)
+{
+	audio_block_t *block;
+
+	for (int i=0; i < num_inputs; i++) {
+		block = receiveReadOnly(i);
+		if (!block) continue;
+		if (i == 0) transmit(block);
+		release(block);
+	}
+}
+
+// Decide if this stream can skip its update: all inputs have been silent
+// for longer than its tail.  A block on any input wakes it up again.
+bool AudioStream::update_silent(void)
+{
+	int32_t tail;
+
+	if (num_inputs == 0) return false;
+	for (int i=0; i < num_inputs; i++) {
+		if (inputQueue[i]) {
+			silent_samples = 0;
+			sleeping = false;
+			return false;
+		}
+	}
+	if (sleeping) return true;
+	tail = tail_samples();
+	if (tail < 0) return false;
+	if (silent_samples >= (uint32_t)tail) {
+		sleeping = true;
+		return true;
+	}
+	silent_samples += AUDIO_BLOCK_SAMPLES;
+	return false;
+}
+
+// Run the update of one stream, and keep its CPU statistics
+void AudioStream::update_timed(void)
+{
+	uint32_t startTick = xthal_get_ccount();
+	if (fused) {
+		fused = false;		// its head ran it
+	} else if (update_silent()) {
+		// sleeping, nothing to do
+	} else if (!fuse_next || !update_fused()) {
+		if (degraded == DEGRADE_BYPASS) update_bypass();
+		else update();
+	}
+	uint32_t finishTick = xthal_get_ccount();
+	context->update_stream_clocks[core & 1] += finishTick - startTick;
+	if (!blocking) context->update_work_clocks[core & 1] += finishTick - startTick;
+#if AUDIO_TRACE
+	uint32_t clocks = finishTick - startTick;
+	int bucket = clocks ? 31 - __builtin_clz(clocks) : 0;
+	if (bucket >= AUDIO_TRACE_BUCKETS) bucket = AUDIO_TRACE_BUCKETS - 1;
+	clocksHistogram[bucket]++;
+	if (context->trace_on) context->trace(name, startTick, finishTick, core);
+#endif
+
+	if(blocking || !initialised){
+		clocksPerUpdate = 0;
+		// esp_task_wdt_reset();
+		return;
+	}
+	if(finishTick > startTick)		//Ignore the wraparound boundary
+	{
+		clocksPerUpdate = (finishTick - startTick) - 11;			//11 is the minimum clocks to get the timer values
+		clocksPerSecondSum += clocksPerUpdate;
+		if(clocksPerUpdate > clocksPerUpdateMax)
+			clocksPerUpdateMax = clocksPerUpdate;
+		if(clocksPerUpdate < clocksPerUpdateMin)
+			clocksPerUpdateMin = clocksPerUpdate;
+		if(context->update_second_elapsed)
+		{
+			clocksPerUpdateMax = clocksPerUpdate;			//Reset max
+			clocksPerUpdateMin = clocksPerUpdate;			//Reset min
+			clocksPerSecond = clocksPerSecondSum;
+			clocksPerSecondSum = 0;							//Reset sum
+		}
+	}
+}
+
+// Run the streams of one stage that belong to this core
+void AudioContext::update_stage_on(uint8_t stage, int core)
+{
+	for (AudioStream *p = first_update; p; p = p->next_update) {
+		if (p->active && p->update_stage == stage && p->core == core) p->update_timed();
+	}
+}
+
+void AudioContext::update_worker(void *parameter)
+{
+	AudioContext *context = (AudioContext *)parameter;
+
+	for(;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		context->update_stage_on(AudioStream::UPDATE_STAGE_BRANCH, context->update_worker_core);
+		xTaskNotifyGive((TaskHandle_t)context->update_caller_task);
+	}
+}
+
+// Start a task on the given core, which runs about half of the
+// independent branches of the graph in every update_all
+bool AudioContext::enable_parallel_update(int core, unsigned int priority)
+{
+	if (update_worker_task) return true;
+	update_worker_core = core;
+	if (xTaskCreatePinnedToCore(update_worker, "AudioWorker", 4096, this, priority,
+			(TaskHandle_t *)&update_worker_task, core) != pdPASS) {
+		update_worker_task = NULL;
+		update_worker_core = -1;
+		return false;
+	}
+	update_caller_core = -1;	// partition again on the next update_all
+	return true;
+}
+
+void AudioContext::update_all(void)
+{
+	AudioStream *p;
+	bool partition = false;
+	uint32_t startTick = xthal_get_ccount(), waitClocks = 0;
+
+	// parameters first: a deleted object's last changes come before it goes
+	if (command_tail != __atomic_load_n(&command_head, __ATOMIC_RELAXED)) command_apply();
+	if (first_fade || patch_applied != __atomic_load_n(&patch_committed, __ATOMIC_RELAXED)) patch_apply();
+	if (update_order_dirty) {
+		update_order();
+		partition = true;
+	}
+	if (update_caller_core != xPortGetCoreID()) {
+		update_caller_core = xPortGetCoreID();
+		__atomic_store_n(&update_caller_task, (void *)xTaskGetCurrentTaskHandle(), __ATOMIC_RELEASE);
+		partition = true;
+	}
+	if (partition) update_partition();
+	update_second_elapsed = (update_per_second_counter == (updates_per_second - 1));
+	update_stream_clocks[update_caller_core & 1] = 0;
+	update_work_clocks[0] = update_work_clocks[1] = 0;
+
+	if (update_split) {
+		update_stage_on(AudioStream::UPDATE_STAGE_FIRST, update_caller_core);
+		xTaskNotifyGive((TaskHandle_t)update_worker_task);
+		update_stage_on(AudioStream::UPDATE_STAGE_BRANCH, update_caller_core);
+		uint32_t waitTick = xthal_get_ccount();
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		waitClocks = xthal_get_ccount() - waitTick;
+		update_stage_on(AudioStream::UPDATE_STAGE_LAST, update_caller_core);
+	} else {
+		//portMUX_TYPE mux = portMUX_INITIALIZER_UNLOCKED;
+		for (p = first_update; p; p = p->next_update) {
+			if (p->active) p->update_timed();
 		}
 	}
-	updatePerSecondCounter++;
-	if(updatePerSecondCounter == updatesPerSecond)
-		updatePerSecondCounter = 0;
-  //printf("%d",updatePerSecondCounter);
-	if(!p->blockingObjectRunning)
+	// what update_all itself costs, besides the updates and waiting for the other core
+	clocksOverhead = (xthal_get_ccount() - startTick) - update_stream_clocks[update_caller_core & 1] - waitClocks;
+	if (update_second_elapsed || clocksOverhead > clocksOverheadMax) clocksOverheadMax = clocksOverhead;
+	// the block's processing, both cores working at once
+	blockClocks = clocksOverhead + (update_work_clocks[0] > update_work_clocks[1] ?
+		update_work_clocks[0] : update_work_clocks[1]);
+	if (update_second_elapsed || blockClocks > blockClocksMax) blockClocksMax = blockClocks;
+	bool overrun = blockClocks > deadlineClocks;
+	if (overrun) overruns++;
+#if AUDIO_TRACE
+	if (trace_on) {
+		trace(NULL, startTick, xthal_get_ccount(), update_caller_core);
+		if (overrun && trace_stop_on_overrun) trace_on = false;
+	}
+#endif
+	if (degrade) degrade(*this, overrun);
+	__atomic_store_n(&sample_clock, sample_clock + AUDIO_BLOCK_SAMPLES, __ATOMIC_RELEASE);
+	update_per_second_counter++;
+	if(update_per_second_counter == updates_per_second) {
+		update_per_second_counter = 0;
+		if (update_split) update_partition();		//Rebalance the cores with the last second's clocks
+	}
+  //printf("%d",update_per_second_counter);
+	if(!blockingObjectRunning)
 		vTaskDelay(1000/portTICK_PERIOD_MS);		//If user is calling update_all but there aren't any streams controlling the timing, this'll stop 100% CPU
 
-}
\ No newline at end of file
+}
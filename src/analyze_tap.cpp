@@ -0,0 +1,97 @@
+#include "analyze_tap.h"
+#include "AudioKernels.h"
+#include "esp_heap_caps.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+static const char *TAG = "AudioAnalyzeTap";
+
+bool AudioAnalyzeTap::begin(AudioTapCallback callback, void *arg, unsigned int batch,
+	unsigned int blocks, int core, unsigned int priority)
+{
+	if (task || !callback) return false;
+	if (batch == 0) batch = 1;
+	// room for the worker to take one batch while the next fills
+	if (blocks < batch * 2) blocks = batch * 2;
+	blocks = (blocks + batch - 1) / batch * batch;
+	ring = (float *)heap_caps_malloc(blocks * AUDIO_BLOCK_SAMPLES * sizeof(float),
+		MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+	if (!ring) {
+		ESP_LOGE(TAG, "no memory for %u blocks", blocks);
+		return false;
+	}
+	ring_blocks = blocks;
+	batch_blocks = batch;
+	this->callback = callback;
+	callback_arg = arg;
+	head = tail = 0;
+	if (xTaskCreatePinnedToCore(worker, "AudioTap", 4096, this, priority,
+			(TaskHandle_t *)&task, core) != pdPASS) {
+		ESP_LOGE(TAG, "no task");
+		heap_caps_free(ring);
+		ring = NULL;
+		task = NULL;
+		return false;
+	}
+	return true;
+}
+
+AudioAnalyzeTap::~AudioAnalyzeTap()
+{
+	end();		// update() no longer runs
+	if (task) {
+		// the worker may be in the callback, on the other core: let it
+		// finish the batch and delete itself before the ring goes
+		__atomic_store_n(&stopper, (void *)xTaskGetCurrentTaskHandle(), __ATOMIC_RELEASE);
+		xTaskNotifyGive((TaskHandle_t)task);
+		while (!__atomic_load_n(&stopped, __ATOMIC_ACQUIRE)) {
+			ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		}
+	}
+	if (ring) heap_caps_free(ring);
+}
+
+void AudioAnalyzeTap::worker(void *parameter)
+{
+	AudioAnalyzeTap *tap = (AudioAnalyzeTap *)parameter;
+
+	TaskHandle_t stopper;
+
+	for(;;) {
+		ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+		while (!__atomic_load_n(&tap->stopper, __ATOMIC_ACQUIRE) &&
+				tap->filled(__atomic_load_n(&tap->head, __ATOMIC_ACQUIRE), tap->tail) >= tap->batch_blocks) {
+			const float *samples = tap->ring + (tap->tail % tap->ring_blocks) * AUDIO_BLOCK_SAMPLES;
+			tap->callback(samples, tap->batch_blocks, tap->callback_arg);
+			__atomic_store_n(&tap->tail, tap->advance(tap->tail, tap->batch_blocks), __ATOMIC_RELEASE);
+		}
+		stopper = (TaskHandle_t)__atomic_load_n(&tap->stopper, __ATOMIC_ACQUIRE);
+		if (stopper) break;
+	}
+	// the tap may be gone as soon as stopped is seen
+	__atomic_store_n(&tap->stopped, true, __ATOMIC_RELEASE);
+	xTaskNotifyGive(stopper);
+	vTaskDelete(NULL);
+}
+
+void IRAM_ATTR AudioAnalyzeTap::update(void)
+{
+	audio_block_t *block;
+
+	block = receiveReadOnly();
+	if (!task) {
+		if (block) release(block);
+		return;
+	}
+	if (filled(head, __atomic_load_n(&tail, __ATOMIC_ACQUIRE)) >= ring_blocks) {
+		drops++;
+	} else {
+		float *dst = ring + (head % ring_blocks) * AUDIO_BLOCK_SAMPLES;
+		// no block is silence
+		if (block) audio_copy(dst, block->data);
+		else audio_fill(dst, 0.0f);
+		__atomic_store_n(&head, advance(head, 1), __ATOMIC_RELEASE);
+		if (head % batch_blocks == 0) xTaskNotifyGive((TaskHandle_t)task);
+	}
+	if (block) release(block);
+}
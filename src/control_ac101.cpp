@@ -197,8 +197,8 @@ bool AudioControlAC101::begin(int sda, int scl, uint32_t frequency)
 	ok &= WriteReg(MOD_CLK_ENA, 0x800c);
 	ok &= WriteReg(MOD_RST_CTRL, 0x800c);
 
-	// Set default at I2S, 44.1KHz, 24bit
-	ok &= SetI2sSampleRate(SAMPLE_RATE_44100);
+	// Set default at I2S, graph sample rate (44.1KHz), 24bit
+	ok &= SetI2sSampleRate(SampleRate(AudioContext::global().sample_rate));
 	ok &= SetI2sClock(BCLK_DIV_1, false, LRCK_DIV_64, false);
 	ok &= SetI2sMode(MODE_SLAVE);
 	ok &= SetI2sWordSize(WORD_SIZE_24_BITS);
@@ -284,6 +284,23 @@ bool AudioControlAC101::SetVolumeHeadphone(uint8_t volume)
 	return WriteReg(HPOUT_CTRL, val);
 }
 
+// The codec rate setting nearest to a sample rate in Hz.
+// The AC101 has no 88.2KHz setting, that one runs at 96KHz.
+AudioControlAC101::I2sSampleRate_t AudioControlAC101::SampleRate(float hz)
+{
+	if (hz <= 8000.0f) return SAMPLE_RATE_8000;
+	if (hz <= 11025.0f) return SAMPLE_RATE_11052;
+	if (hz <= 12000.0f) return SAMPLE_RATE_12000;
+	if (hz <= 16000.0f) return SAMPLE_RATE_16000;
+	if (hz <= 22050.0f) return SAMPLE_RATE_22050;
+	if (hz <= 24000.0f) return SAMPLE_RATE_24000;
+	if (hz <= 32000.0f) return SAMPLE_RATE_32000;
+	if (hz <= 44100.0f) return SAMPLE_RATE_44100;
+	if (hz <= 48000.0f) return SAMPLE_RATE_48000;
+	if (hz <= 96000.0f) return SAMPLE_RATE_96000;
+	return SAMPLE_RATE_192000;
+}
+
 bool AudioControlAC101::SetI2sSampleRate(I2sSampleRate_t rate)
 {
 	return WriteReg(I2S_SR_CTRL, rate);
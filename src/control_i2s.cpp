@@ -2,21 +2,228 @@
 #include "driver/i2s.h"
 #include "control_ac101.h"
 #include "Arduino.h"
+#include "AudioKernels.h"
 
 #define I2S_BCK_IO      (GPIO_NUM_27)
 #define I2S_WS_IO       (GPIO_NUM_26)
 #define I2S_DO_IO       (GPIO_NUM_25)
 #define I2S_DI_IO       (GPIO_NUM_35)
 
-//dma buffer length 32 bytes (8 samples: 4L+4R)
-#define DMABUFFERLENGTH 32
-//dma buffer count 20 (640 Bytes: 160 samples: 80L+80R) 
-#define DMABUFFERCOUNT  20
-
 static const char *TAG = "AudioControlI2S";
 
 bool AudioControlI2S::configured = false;
 uint8_t AudioControlI2S::bits = 32; // 16?!?
+i2s_port_t AudioControlI2S::port = I2S_NUM_0;
+QueueHandle_t AudioControlI2S::events = NULL;
+uint8_t AudioControlI2S::buffer_count = AUDIO_I2S_DMA_BUFFERS;
+uint16_t AudioControlI2S::buffer_length = AUDIO_BLOCK_SAMPLES;
+uint8_t AudioControlI2S::dma_buffers = 0;
+uint16_t AudioControlI2S::dma_length = AUDIO_BLOCK_SAMPLES;
+uint8_t AudioControlI2S::rx_ready = 0;
+uint8_t AudioControlI2S::tx_ready = 0;
+bool AudioControlI2S::reading = false;
+bool AudioControlI2S::writing = false;
+bool AudioControlI2S::glitched = false;
+bool AudioControlI2S::resync = false;
+uint32_t AudioControlI2S::underruns = 0;
+uint32_t AudioControlI2S::underrunTime = 0;
+uint32_t AudioControlI2S::overruns = 0;
+uint32_t AudioControlI2S::overrunTime = 0;
+
+bool AudioControlI2S::buffers(unsigned int count, unsigned int length)
+{
+	if (!valid_buffers(count, length)) return false;
+	buffer_count = count;
+	buffer_length = length;
+	return true;
+}
+
+// The driver posts an event for every DMA buffer it has filled or
+// played.  With whole buffers to a block, the I2S objects wait on those
+// and then read or write a block without blocking in the driver.
+esp_err_t AudioControlI2S::install(i2s_port_t i2s_port, const i2s_config_t *i2s_config)
+{
+	// room for every buffer of both directions, and a spare
+	int queue_size = i2s_config->dma_buf_count * 2 + 2;
+	int frame_bytes = (i2s_config->bits_per_sample == 16 ? 2 : 4) * 2;
+	esp_err_t err;
+
+	// the driver's limit for one buffer
+	if (i2s_config->dma_buf_len * frame_bytes > 4092) {
+		ESP_LOGE(TAG, "DMA buffers of %d frames are over 4092 bytes", i2s_config->dma_buf_len);
+		return ESP_ERR_INVALID_ARG;
+	}
+	err = i2s_driver_install(i2s_port, i2s_config, queue_size, &events);
+	port = i2s_port;
+	dma_buffers = (uint8_t)i2s_config->dma_buf_count;
+	dma_length = (uint16_t)i2s_config->dma_buf_len;
+	rx_ready = tx_ready = 0;
+	if (err != ESP_OK) {
+		events = NULL;
+		dma_buffers = 0;
+		dma_length = AUDIO_BLOCK_SAMPLES;
+	} else if (AUDIO_BLOCK_SAMPLES % dma_length != 0 || dma_buffers * dma_length <= AUDIO_BLOCK_SAMPLES) {
+		ESP_LOGW(TAG, "%d DMA buffers of %d frames don't fit blocks of %d: I2S reads and writes block",
+			dma_buffers, dma_length, AUDIO_BLOCK_SAMPLES);
+		events = NULL;
+	}
+	if (err == ESP_OK) {
+		ESP_LOGI(TAG, "%d DMA buffers of %d frames: %.1f ms", dma_buffers, dma_length,
+			latencySamples() * 1000.0f / AudioContext::global().sample_rate);
+	}
+	return err;
+}
+
+// Wait until the driver has finished a buffer: I2S_EVENT_RX_DONE for
+// one to read, I2S_EVENT_TX_DONE for one to fill.  The events of the
+// other direction are counted for its object.
+void IRAM_ATTR AudioControlI2S::wait_buffer(i2s_event_type_t type)
+{
+	uint8_t &ready = (type == I2S_EVENT_RX_DONE) ? rx_ready : tx_ready;
+	uint8_t per_block = AUDIO_BLOCK_SAMPLES / dma_length;
+	i2s_event_t event;
+
+	while (events && ready < per_block) {
+		if (xQueueReceive(events, &event, portMAX_DELAY) != pdTRUE) return;
+		switch (event.type) {
+			case I2S_EVENT_RX_DONE:
+				// the driver drops its oldest buffer when all are full
+				if (rx_ready < dma_buffers) rx_ready++;
+				break;
+			case I2S_EVENT_TX_DONE:
+				if (tx_ready < dma_buffers) tx_ready++;
+				break;
+			// a direction nobody uses overflows all the time
+			case I2S_EVENT_TX_Q_OVF:
+				if (!writing) break;
+				underruns++;
+				underrunTime = AudioContext::global().sample_time();
+				glitched = resync;
+				break;
+			case I2S_EVENT_RX_Q_OVF:
+				if (!reading) break;
+				overruns++;
+				overrunTime = AudioContext::global().sample_time();
+				glitched = resync;
+				break;
+			default:
+				break;
+		}
+	}
+	ready = ready > per_block ? ready - per_block : 0;
+}
+
+size_t IRAM_ATTR AudioControlI2S::read(void *dst, size_t bytes)
+{
+	size_t done = 0, more = 0;
+
+	reading = true;
+	wait_buffer(I2S_EVENT_RX_DONE);
+	i2s_read(port, dst, bytes, &done, 0);
+	if (done < bytes) {
+		// no event queue, or it got ahead of the driver: wait for the rest
+		i2s_read(port, (char *)dst + done, bytes - done, &more, portMAX_DELAY);
+		done += more;
+	}
+	return done;
+}
+
+size_t IRAM_ATTR AudioControlI2S::write(const void *src, size_t bytes)
+{
+	size_t done = 0, more = 0;
+
+	writing = true;
+	wait_buffer(I2S_EVENT_TX_DONE);
+	i2s_write(port, src, bytes, &done, 0);
+	if (done < bytes) {
+		i2s_write(port, (const char *)src + done, bytes - done, &more, portMAX_DELAY);
+		done += more;
+	}
+	return done;
+}
+
+// Start both directions again from empty DMA buffers, at the same
+// instant, with no events pending
+void AudioControlI2S::restart(void)
+{
+	i2s_stop(port);
+	i2s_zero_dma_buffer(port);
+	if (events) xQueueReset(events);
+	rx_ready = tx_ready = 0;
+	reading = writing = glitched = false;
+	i2s_start(port);
+}
+
+// True once after a glitch when resync is on: the first I2S object to
+// update then restarts the port
+bool AudioControlI2S::resync_due(void)
+{
+	if (!glitched) return false;
+	glitched = false;
+	return true;
+}
+
+// A block of frames from the DMA buffers into the two channels.  The
+// bits of each channel come back too, 0 for digital silence.
+void IRAM_ATTR AudioControlI2S::unpack(const int32_t *src, float *left, float *right, uint32_t &left_bits, uint32_t &right_bits)
+{
+	left_bits = right_bits = 1;
+	switch(bits)
+	{
+		case 16:
+			// the built-in ADC: 12 bits, offset binary
+			for(int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+			{
+				left[i] = ((float)(src[i] & 0xfff)/2048.0f) - 1.0f;
+			}
+			audio_copy(right, left);		// one ADC pin: mono
+			break;
+		case 24:
+			left_bits = audio_from_pcm(left, src, 2, 24, 1.0f / 8388608.0f);
+			right_bits = audio_from_pcm(right, src + 1, 2, 24, 1.0f / 8388608.0f);
+			break;
+		case 32:
+			left_bits = audio_from_pcm(left, src, 2, 32, 1.0f / 1073741823.0f);
+			right_bits = audio_from_pcm(right, src + 1, 2, 32, 1.0f / 1073741823.0f);
+			break;
+		default:
+			printf("Unknown bit depth\n");
+			break;
+	}
+}
+
+// The two channels into a block of frames for the DMA buffers; a NULL
+// channel is silent
+void IRAM_ATTR AudioControlI2S::pack(int32_t *dst, const float *left, const float *right)
+{
+	switch(bits)
+	{
+		case 16:
+			// the built-in DAC: both channels in one word, offset binary.
+			// Each goes to the top half of its own int32 first.
+			audio_to_pcm(dst, 1, left, 16, 32767.0f);
+			audio_to_pcm(dst + AUDIO_BLOCK_SAMPLES, 1, right, 16, 32767.0f);
+			for(int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+			{
+				uint32_t l = (uint32_t)dst[i] >> 16;
+				uint32_t r = (uint32_t)dst[AUDIO_BLOCK_SAMPLES + i] & 0xffff0000;
+				dst[i] = (int32_t)((r | l) ^ 0x80008000);
+			}
+			break;
+		case 24:
+			// this codec takes the channels swapped and inverted
+			audio_to_pcm(dst + 1, 2, left, 24, -8388608.0f);
+			audio_to_pcm(dst, 2, right, 24, -8388608.0f);
+			break;
+		case 32:
+			audio_to_pcm(dst, 2, left, 32, 1073741823.0f);
+			audio_to_pcm(dst + 1, 2, right, 32, 1073741823.0f);
+			break;
+		default:
+			printf("Unknown bit depth\n");
+			break;
+	}
+}
 
 void AudioControlI2S::start(i2s_port_t i2s_port, i2s_config_t* i2s_config, i2s_pin_config_t* i2s_pin_config, bool outputMCLK)
 {
@@ -25,7 +232,7 @@ void AudioControlI2S::start(i2s_port_t i2s_port, i2s_config_t* i2s_config, i2s_p
         bits = (uint8_t)i2s_config->bits_per_sample;
 
 		//printf("+%d %p\n", 0, i2s_config);
-		if (i2s_driver_install(i2s_port, i2s_config, 0, NULL) != ESP_OK) 
+		if (install(i2s_port, i2s_config) != ESP_OK) 
 		{
 			printf("ERROR: Unable to install I2S driver\n");
 		} else {
@@ -66,13 +273,13 @@ void AudioControlI2S::default_codec_rx_tx_24bit()
     i2s_mode_t mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_RX);
     i2s_config_t i2s_config = {
         .mode = mode,                               
-        .sample_rate = AUDIO_SAMPLE_RATE_EXACT,
+        .sample_rate = (int)AudioContext::global().sample_rate,
         .bits_per_sample = I2S_BITS_PER_SAMPLE_24BIT,
         .channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,                           //2-channels
         .communication_format = (i2s_comm_format_t)(I2S_COMM_FORMAT_I2S | I2S_COMM_FORMAT_I2S_MSB),
         .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,                               //lowest interrupt priority
-        .dma_buf_count = 2,
-        .dma_buf_len = AUDIO_BLOCK_SAMPLES,
+        .dma_buf_count = buffer_count,
+        .dma_buf_len = buffer_length,
         .use_apll = 1,
         .tx_desc_auto_clear = true,
         .fixed_mclk = MCLK
@@ -91,13 +298,13 @@ void AudioControlI2S::default_adc_dac()
     i2s_mode_t mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_RX | I2S_MODE_DAC_BUILT_IN | I2S_MODE_ADC_BUILT_IN);
     i2s_config_t i2s_config = {
     	.mode = mode,
-    	.sample_rate = AUDIO_SAMPLE_RATE_EXACT,
+    	.sample_rate = (int)AudioContext::global().sample_rate,
     	.bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
     	.channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT,
     	.communication_format = I2S_COMM_FORMAT_I2S_MSB,
     	.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1, 
-    	.dma_buf_count = 2,
-    	.dma_buf_len = AUDIO_BLOCK_SAMPLES,
+    	.dma_buf_count = buffer_count,
+    	.dma_buf_len = buffer_length,
     	.use_apll = 0,
         .tx_desc_auto_clear = true,
         .fixed_mclk = 0
@@ -110,12 +317,12 @@ void AudioControlI2S::ac101()
  
   i2s_config_t i2s_config;
   i2s_config.mode =(i2s_mode_t) (I2S_MODE_MASTER | I2S_MODE_TX | I2S_MODE_RX);
-  i2s_config.sample_rate = AUDIO_SAMPLE_RATE_EXACT;
+  i2s_config.sample_rate = (int)AudioContext::global().sample_rate;
   i2s_config.bits_per_sample = (i2s_bits_per_sample_t) 32; 
   i2s_config.channel_format = I2S_CHANNEL_FMT_RIGHT_LEFT;
   i2s_config.communication_format = (i2s_comm_format_t)(I2S_COMM_FORMAT_I2S | I2S_COMM_FORMAT_I2S_MSB);
-  i2s_config.dma_buf_count = DMABUFFERCOUNT;
-  i2s_config.dma_buf_len = DMABUFFERLENGTH;
+  i2s_config.dma_buf_count = buffer_count;
+  i2s_config.dma_buf_len = buffer_length;
   i2s_config.use_apll = false;
   i2s_config.intr_alloc_flags = ESP_INTR_FLAG_LEVEL1;
   
@@ -128,11 +335,11 @@ void AudioControlI2S::ac101()
   configured=true;
   ESP_LOGI(TAG, "Starting AC101 I2S config");
 //  start((i2s_port_t)0, &i2s_config, &pin_config, false);
-  if(i2s_driver_install((i2s_port_t)I2S_NUM, &i2s_config, 0, NULL) != ESP_OK)
+  if(install((i2s_port_t)I2S_NUM, &i2s_config) != ESP_OK)
     { ESP_LOGE(TAG,"i2s driver install error"); configured=false; }
   if(i2s_set_pin((i2s_port_t)I2S_NUM, &pin_config) != ESP_OK)
     { ESP_LOGE(TAG,"i2s set pin error"); configured=false; }
-  if(i2s_set_clk((i2s_port_t)I2S_NUM, AUDIO_SAMPLE_RATE_EXACT, (i2s_bits_per_sample_t) 32, I2S_CHANNEL_STEREO) != ESP_OK)
+  if(i2s_set_clk((i2s_port_t)I2S_NUM, (uint32_t)AudioContext::global().sample_rate, (i2s_bits_per_sample_t) 32, I2S_CHANNEL_STEREO) != ESP_OK)
     { ESP_LOGE(TAG,"i2s set clk error"); configured=false; }
 
   if(configured) {
@@ -146,6 +353,7 @@ AudioControlI2S::~AudioControlI2S(){
     if(configured)
     {
         ESP_LOGI(TAG, "Uninstall I2S.");
-        i2s_driver_uninstall((i2s_port_t)0); //stop & destroy i2s driver
+        i2s_driver_uninstall(port); //stop & destroy i2s driver
+        events = NULL;
     }
 }
\ No newline at end of file
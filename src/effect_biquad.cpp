@@ -1,4 +1,5 @@
 #include "effect_biquad.h"
+#include "AudioKernels.h"
 #include "AudioStream.h"
 #include <math.h>
 #include "Arduino.h"
@@ -6,70 +7,67 @@
 void IRAM_ATTR AudioFilterBiquad::update(void)
 {
 	audio_block_t *block;
+	float start, end;
+
+	// a frequency change moves the coefficients once a block
+	if (receiveControl(0, start, end)) {
+		if (end != design_freq.value()) {
+			design_freq.jump(end);
+			design();
+		}
+	} else if (design_freq.ramping()) {
+		design_freq.skip(AUDIO_BLOCK_SAMPLES);
+		design();
+	}
 
 	block = receiveWritable(0);
 
-	if (!block) {
-		return;
-	}
-
-  // biquad filtering is based on a small sliding window, where the different filters are a result of
-  // simply changing the coefficients used while processing the samples
-  //
-  // the biquad filter processes a sound using 10 parameters:
-  //   b0, b1, b2, a1, a2      transformation coefficients
-  //   xn0, xn1, xn2           the unfiltered sample at position x[n], x[n-1], and x[n-2]
-  //   yn1, yn2                the filtered sample at position y[n-1] and y[n-2]
-  //void sf_biquad_process(sf_biquad_state_st *state, int size, audio_block_t *input,
-  //	audio_block_t *output){
-
-	// pull out the state into local variables
-	float b0  = biquadState.b0;
-	float b1  = biquadState.b1;
-	float b2  = biquadState.b2;
-	float a1  = biquadState.a1;
-	float a2  = biquadState.a2;
-	float xn1 = biquadState.xn1;
-	float xn2 = biquadState.xn2;
-	float yn1 = biquadState.yn1;
-	float yn2 = biquadState.yn2;
-
-	// loop for each sample
-	for (int n = 0; n < AUDIO_BLOCK_SAMPLES; n++){
-		// get the current sample
-		float xn0 = block->data[n];
-
-		// the formula is the same for each channel
-		block->data[n] = 
-			b0 * xn0 +
-			b1 * xn1 +
-			b2 * xn2 -
-			a1 * yn1 -
-			a2 * yn2;
-
-		// slide everything down one sample
-		xn2 = xn1;
-		xn1 = xn0;
-		yn2 = yn1;
-		yn1 = block->data[n];
+	if (block) {
+		ringing = 0;
+	} else {
+		// silence is no block, but the filter rings on: run it on zeros
+		// for its tail, then clear the state so the next block starts clean
+		if (biquadState.w[0] == 0.0f && biquadState.w[1] == 0.0f) return;
+		block = allocate();
+		if (!block) return;
+		audio_fill(block->data, 0.0f);
+		ringing += AUDIO_BLOCK_SAMPLES;
 	}
 
-	// save the state for future processing
-	biquadState.xn1 = xn1;
-	biquadState.xn2 = xn2;
-	biquadState.yn1 = yn1;
-	biquadState.yn2 = yn2;
+	// biquad filtering is based on a small sliding window, where the different
+	// filters are a result of simply changing the coefficients used while
+	// processing the samples.  It runs in direct form II, the form esp-dsp has:
+	//   b0, b1, b2, a1, a2      transformation coefficients
+	//   w[0], w[1]              the feedback sums of the last 2 samples
+	float coef[5] = { biquadState.b0, biquadState.b1, biquadState.b2,
+		biquadState.a1, biquadState.a2 };
+	audio_biquad(block->data, block->data, coef, biquadState.w);
 
 	transmit(block);
 	release(block);
+	if (ringing >= (uint32_t)tail) state_reset();
 }
 
 // clear the samples saved across process boundaries
 void AudioFilterBiquad::state_reset(){
-	biquadState.xn1 = 0;
-	biquadState.xn2 = 0;
-	biquadState.yn1 = 0;
-	biquadState.yn2 = 0;
+	biquadState.w[0] = 0;
+	biquadState.w[1] = 0;
+}
+
+// the samples the filter takes to decay by 100 dB, from the radius of
+// its larger pole; -1 if it doesn't decay, and at most 10 seconds
+void AudioFilterBiquad::state_tail(){
+	float a1 = biquadState.a1, a2 = biquadState.a2;
+	float disc = a1 * a1 - 4.0f * a2;
+	float r = disc < 0.0f ? sqrtf(a2) : (fabsf(a1) + sqrtf(disc)) * 0.5f;
+	float max = sample_rate * 10.0f;
+
+	if (r >= 1.0f)
+		tail = -1;
+	else if (r <= 0.0f)
+		tail = 2;
+	else
+		tail = 2 + (int32_t)fminf(ceilf(-11.513f / logf(r)), max);
 }
 
 // set the coefficients so that the output is the input scaled by `amt`
@@ -91,10 +89,9 @@ void AudioFilterBiquad::state_zero(){
 	state_scale(0.0f);
 }
 
-// initialize the biquad state to be a lowpass filter
-void AudioFilterBiquad::lowpass(float cutoff, float resonance){
-	state_reset();
-	float nyquist = AUDIO_SAMPLE_RATE_EXACT * 0.5f;
+// the coefficients for a lowpass filter
+void AudioFilterBiquad::design_lowpass(float cutoff, float resonance){
+	float nyquist = sample_rate * 0.5f;
 	cutoff /= nyquist;
 
 	if (cutoff >= 1.0f)
@@ -116,9 +113,8 @@ void AudioFilterBiquad::lowpass(float cutoff, float resonance){
 	}
 }
 
-void AudioFilterBiquad::highpass(float cutoff, float resonance){
-	state_reset();
-	float nyquist = AUDIO_SAMPLE_RATE_EXACT * 0.5f;
+void AudioFilterBiquad::design_highpass(float cutoff, float resonance){
+	float nyquist = sample_rate * 0.5f;
 	cutoff /= nyquist;
 
 	if (cutoff >= 1.0f)
@@ -140,9 +136,8 @@ void AudioFilterBiquad::highpass(float cutoff, float resonance){
 	}
 }
 
-void AudioFilterBiquad::bandpass(float freq, float Q){
-	state_reset();
-	float nyquist = AUDIO_SAMPLE_RATE_EXACT * 0.5f;
+void AudioFilterBiquad::design_bandpass(float freq, float Q){
+	float nyquist = sample_rate * 0.5f;
 	freq /= nyquist;
 
 	if (freq <= 0.0f || freq >= 1.0f)
@@ -162,9 +157,8 @@ void AudioFilterBiquad::bandpass(float freq, float Q){
 	}
 }
 
-void AudioFilterBiquad::notch(float freq, float Q){
-	state_reset();
-	float nyquist = AUDIO_SAMPLE_RATE_EXACT * 0.5f;
+void AudioFilterBiquad::design_notch(float freq, float Q){
+	float nyquist = sample_rate * 0.5f;
 	freq /= nyquist;
 
 	if (freq <= 0.0f || freq >= 1.0f)
@@ -184,9 +178,8 @@ void AudioFilterBiquad::notch(float freq, float Q){
 	}
 }
 
-void AudioFilterBiquad::peaking(float freq, float Q, float gain){
-	state_reset();
-	float nyquist = AUDIO_SAMPLE_RATE_EXACT * 0.5f;
+void AudioFilterBiquad::design_peaking(float freq, float Q, float gain){
+	float nyquist = sample_rate * 0.5f;
 	freq /= nyquist;
 
 	if (freq <= 0.0f || freq >= 1.0f){
@@ -212,9 +205,8 @@ void AudioFilterBiquad::peaking(float freq, float Q, float gain){
 	biquadState.a2 = a0inv * (1.0f - alpha / A);
 }
 
-void AudioFilterBiquad::allpass(float freq, float Q){
-	state_reset();
-	float nyquist = AUDIO_SAMPLE_RATE_EXACT * 0.5f;
+void AudioFilterBiquad::design_allpass(float freq, float Q){
+	float nyquist = sample_rate * 0.5f;
 	freq /= nyquist;
 
 	if (freq <= 0.0f || freq >= 1.0f)
@@ -234,9 +226,8 @@ void AudioFilterBiquad::allpass(float freq, float Q){
 	}
 }
 
-void AudioFilterBiquad::lowshelf(float freq, float Q, float gain){
-	state_reset();
-	float nyquist = AUDIO_SAMPLE_RATE_EXACT * 0.5f;
+void AudioFilterBiquad::design_lowshelf(float freq, float Q, float gain){
+	float nyquist = sample_rate * 0.5f;
 	freq /= nyquist;
 
 	if (freq <= 0.0f || Q == 0.0f){
@@ -268,9 +259,8 @@ void AudioFilterBiquad::lowshelf(float freq, float Q, float gain){
 	biquadState.a2 = a0inv * (Ap1 + Am1 * k - k2);
 }
 
-void AudioFilterBiquad::highshelf(float freq, float Q, float gain){
-	state_reset();
-	float nyquist = AUDIO_SAMPLE_RATE_EXACT * 0.5f;
+void AudioFilterBiquad::design_highshelf(float freq, float Q, float gain){
+	float nyquist = sample_rate * 0.5f;
 	freq /= nyquist;
 
 	if (freq >= 1.0f || Q == 0.0f){
@@ -300,4 +290,72 @@ void AudioFilterBiquad::highshelf(float freq, float Q, float gain){
 	biquadState.b2 = a0inv * A * (Ap1 + Am1 * k - k2);
 	biquadState.a1 = a0inv * 2.0f * (Am1 - Ap1 * k);
 	biquadState.a2 = a0inv * (Ap1 - Am1 * k - k2);
-}
\ No newline at end of file
+}
+
+void AudioFilterBiquad::lowpass(float cutoff, float resonance){
+	set_design(DESIGN_LOWPASS, cutoff, resonance, 0);
+}
+
+void AudioFilterBiquad::highpass(float cutoff, float resonance){
+	set_design(DESIGN_HIGHPASS, cutoff, resonance, 0);
+}
+
+void AudioFilterBiquad::bandpass(float freq, float Q){
+	set_design(DESIGN_BANDPASS, freq, Q, 0);
+}
+
+void AudioFilterBiquad::notch(float freq, float Q){
+	set_design(DESIGN_NOTCH, freq, Q, 0);
+}
+
+void AudioFilterBiquad::peaking(float freq, float Q, float gain){
+	set_design(DESIGN_PEAKING, freq, Q, gain);
+}
+
+void AudioFilterBiquad::allpass(float freq, float Q){
+	set_design(DESIGN_ALLPASS, freq, Q, 0);
+}
+
+void AudioFilterBiquad::lowshelf(float freq, float Q, float gain){
+	set_design(DESIGN_LOWSHELF, freq, Q, gain);
+}
+
+void AudioFilterBiquad::highshelf(float freq, float Q, float gain){
+	set_design(DESIGN_HIGHSHELF, freq, Q, gain);
+}
+
+// queue a new design for the next block; on the audio task, glide the
+// frequency there if the filter type stays the same, else change at once
+void AudioFilterBiquad::set_design(uint8_t type, float freq, float Q, float gain){
+	if (post(type, freq, Q, gain)) return;
+	if (type == design_type)
+		design_freq.set(freq);
+	else
+		design_freq.jump(freq);
+	design_type = type;
+	design_Q = Q;
+	design_gain = gain;
+	design();
+}
+
+// the coefficients for the current design at the current frequency
+void AudioFilterBiquad::design(){
+	float freq = design_freq.value();
+	switch (design_type){
+		case DESIGN_LOWPASS:   design_lowpass(freq, design_Q); break;
+		case DESIGN_HIGHPASS:  design_highpass(freq, design_Q); break;
+		case DESIGN_BANDPASS:  design_bandpass(freq, design_Q); break;
+		case DESIGN_NOTCH:     design_notch(freq, design_Q); break;
+		case DESIGN_PEAKING:   design_peaking(freq, design_Q, design_gain); break;
+		case DESIGN_ALLPASS:   design_allpass(freq, design_Q); break;
+		case DESIGN_LOWSHELF:  design_lowshelf(freq, design_Q, design_gain); break;
+		case DESIGN_HIGHSHELF: design_highshelf(freq, design_Q, design_gain); break;
+	}
+	state_tail();
+}
+
+// redo the design with the new sample rate
+void AudioFilterBiquad::sample_rate_changed(){
+	design_freq.rate(sample_rate);
+	design();
+}
@@ -1,4 +1,5 @@
 #include "effect_calibration.h"
+#include "AudioKernels.h"
 
 static const char *TAG = "AudioEffectCalibration";
 
@@ -7,40 +8,29 @@ void AudioEffectCalibration::update(void)
 	audio_block_t *blocka;
 
 	blocka = receiveWritable(0);
+    if(!blocka && (c != 0.0f || inputOverrideEnable))
+    {
+        // silence in, which is no block, still gives the offset out
+        blocka = allocate();
+        if(blocka) audio_fill(blocka->data, 0.0f);
+    }
     if(blocka)
     {
         if(averagingEnable)
         {
-            float sum = 0;
-            for(int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
-            {
-                sum += blocka->data[i];
-            }
-            inputAverage = sum/AUDIO_BLOCK_SAMPLES;
+            inputAverage = audio_sum(blocka->data)/AUDIO_BLOCK_SAMPLES;
+        }
+        if(inputOverrideEnable)
+        {
+            audio_fill(blocka->data, inputOverrideValue * m + c);
         }
-        float temp;
-        for(int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+        else
         {
-            if(inputOverrideEnable)
-            {
-                temp = inputOverrideValue;
-            }
-            else
-            {
-                temp = blocka->data[i]; 
-            }
-            temp *= m;
-            temp += c;
-            blocka->data[i] = temp;
+            audio_affine(blocka->data, blocka->data, m, c);
         }
         if(averagingEnable)
         {
-            float sum = 0;
-            for(int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
-            {
-                sum += blocka->data[i];
-            }
-            outputAverage = sum/AUDIO_BLOCK_SAMPLES;
+            outputAverage = audio_sum(blocka->data)/AUDIO_BLOCK_SAMPLES;
         }
         transmit(blocka);
         release(blocka);
@@ -25,13 +25,19 @@
  */
 
 #include "effect_delay.h"
+#include "AudioKernels.h"
 
 void IRAM_ATTR AudioEffectDelay::update(void)
 {
 	audio_block_t *output;
-	uint32_t head, tail, count, channel, index, prev, offset;
-	const float *src, *end;
-	float *dst;
+	uint32_t head, tail, count, channel, index, offset;
+	uint8_t fading;
+	float from, to;
+
+	// delay times from the control inputs
+	for (channel = 0; channel < 8; channel++) {
+		if (receiveControl(channel, from, to) && to != delay_ms[channel]) delay(channel, to);
+	}
 
 	// grab incoming data and put it into the queue
 	head = headindex;
@@ -41,7 +47,7 @@ void IRAM_ATTR AudioEffectDelay::update(void)
 		if (queue[tail] != NULL) release(queue[tail]);
 		if (++tail >= DELAY_QUEUE_SIZE) tail = 0;
 	}
-	queue[head] = receiveReadOnly();
+	queue[head] = receiveHeld();
 	headindex = head;
 
 	// testing only.... don't allow null pointers into the queue
@@ -80,17 +86,33 @@ void IRAM_ATTR AudioEffectDelay::update(void)
 	tailindex = tail;
 
 	// transmit the delayed outputs using queue data
+	fading = fademask;
 	for (channel = 0; channel < 8; channel++) {
 		if (!(activemask & (1<<channel))) continue;
+		if (fademask & (1<<channel)) {
+			fademask &= ~(1<<channel);
+			output = allocate();
+			if (!output) continue;
+			read_delayed(head, position[channel], output->data);
+			// move from the old delay to the new one over this block,
+			// rather than jumping between two points in the signal
+			audio_block_t *old = allocate();
+			if (old) {
+				read_delayed(head, fade_position[channel], old->data);
+				float step = 1.0f / AUDIO_BLOCK_SAMPLES;
+				audio_scale_line(output->data, output->data, 0.0f, step);
+				audio_scale_add_line(output->data, old->data, 1.0f, -step);
+				release(old);
+			}
+			transmit(output, channel);
+			release(output);
+			continue;
+		}
 		index =  position[channel] / AUDIO_BLOCK_SAMPLES;
 		offset = position[channel] % AUDIO_BLOCK_SAMPLES;
-		if (head >= index) {
-			index = head - index;
-		} else {
-			index = DELAY_QUEUE_SIZE + head - index;
-		}
 		if (offset == 0) {
 			// delay falls on the block boundary
+			index = (head >= index) ? head - index : DELAY_QUEUE_SIZE + head - index;
 			if (queue[index]) {
 				transmit(queue[index], channel);
 			}
@@ -98,39 +120,43 @@ void IRAM_ATTR AudioEffectDelay::update(void)
 			// delay requires grabbing data from 2 blocks
 			output = allocate();
 			if (!output) continue;
-			dst = output->data;
-			if (index > 0) {
-				prev = index - 1;
-			} else {
-				prev = DELAY_QUEUE_SIZE-1;
-			}
-			if (queue[prev]) {
-				end = queue[prev]->data + AUDIO_BLOCK_SAMPLES;
-				src = end - offset;
-				while (src < end) {
-					*dst++ = *src++; // TODO: optimize
-				}
-			} else {
-				end = dst + offset;
-				while (dst < end) {
-					*dst++ = 0;
-				}
-			}
-			end = output->data + AUDIO_BLOCK_SAMPLES;
-			if (queue[index]) {
-				src = queue[index]->data;
-				while (dst < end) {
-					*dst++ = *src++; // TODO: optimize
-				}
-			} else {
-				while (dst < end) {
-					*dst++ = 0;
-				}
-			}
+			read_delayed(head, position[channel], output->data);
 			transmit(output, channel);
 			release(output);
 		}
 	}
-
+	// the old positions' blocks can go once their crossfades are done
+	if (fading) recompute_maxblocks();
 }
 
+// a block from delay samples before the end of the block at head
+void AudioEffectDelay::read_delayed(uint32_t head, uint32_t delay, float *data)
+{
+	uint32_t index, prev, offset;
+
+	index = delay / AUDIO_BLOCK_SAMPLES;
+	offset = delay % AUDIO_BLOCK_SAMPLES;
+	if (head >= index) {
+		index = head - index;
+	} else {
+		index = DELAY_QUEUE_SIZE + head - index;
+	}
+	if (index > 0) {
+		prev = index - 1;
+	} else {
+		prev = DELAY_QUEUE_SIZE-1;
+	}
+	if (offset == 0) {
+		// nothing from the block before
+	} else if (queue[prev]) {
+		audio_copy(data, queue[prev]->data + AUDIO_BLOCK_SAMPLES - offset, offset);
+	} else {
+		audio_fill(data, 0.0f, offset);
+	}
+	data += offset;
+	if (queue[index]) {
+		audio_copy(data, queue[index]->data, AUDIO_BLOCK_SAMPLES - offset);
+	} else {
+		audio_fill(data, 0.0f, AUDIO_BLOCK_SAMPLES - offset);
+	}
+}
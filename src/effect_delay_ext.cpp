@@ -26,18 +26,25 @@
 
 #include <Arduino.h>
 #include "effect_delay_ext.h"
+#include "AudioKernels.h"
 #include <stdio.h>
 #include "FreeRTOS.h"
 
 void AudioEffectDelayExternal::update(void) {
 	audio_block_t *block;
-	uint32_t n, channel, read_offset;
+	uint32_t n, channel;
+	float start, end;
+
+	// delay times from the control inputs
+	for (channel = 0; channel < 8; channel++) {
+		if (receiveControl(channel, start, end) && end != delay_ms[channel]) delay(channel, end);
+	}
 
 	// grab incoming data and put it into the memory
 	block = receiveReadOnly();
 	if (memory_type >= AUDIO_MEMORY_UNDEFINED) {
 		// ignore input and do nothing if undefined memory type
-		release(block);
+		if (block) release(block);
 		return;
 	}
 	if (block) {
@@ -53,9 +60,15 @@ void AudioEffectDelayExternal::update(void) {
 			write(0, head_offset, block->data + n);
 		}
 		release(block);
+		zero_count = 0;
+	} else if (zero_count >= memory_length) {
+		// the whole memory is silent already, just move on
+		head_offset += AUDIO_BLOCK_SAMPLES;
+		if (head_offset >= memory_length) head_offset -= memory_length;
 	} else {
 		// if no input, store zeros, so later playback will
 		// not be random garbage previously stored in memory
+		zero_count += AUDIO_BLOCK_SAMPLES;
 		if (head_offset + AUDIO_BLOCK_SAMPLES <= memory_length) {
 			zero(head_offset, AUDIO_BLOCK_SAMPLES);
 			head_offset += AUDIO_BLOCK_SAMPLES;
@@ -70,45 +83,72 @@ void AudioEffectDelayExternal::update(void) {
 	// transmit the delayed outputs
 	for (channel = 0; channel < 8; channel++) {
 		if (!(activemask & (1<<channel))) continue;
+		bool fading = fademask & (1<<channel);
+		fademask &= ~(1<<channel);
+		// silence all the way back to the delayed location
+		if (delay_length[channel] <= zero_count &&
+		    (!fading || fade_length[channel] <= zero_count)) continue;
 		block = allocate();
 		if (!block) continue;
-		// compute the delayed location where we read
-		if (delay_length[channel] <= head_offset) {
-			read_offset = head_offset - delay_length[channel];
-		} else {
-			read_offset = memory_length + head_offset - delay_length[channel];
-		}
-		if (read_offset + AUDIO_BLOCK_SAMPLES <= memory_length) {
-			// a single read will do it
-			read(read_offset, AUDIO_BLOCK_SAMPLES, block->data);
-		} else {
-			// read wraps across end-of-memory
-			n = memory_length - read_offset;
-			read(read_offset, n, block->data);
-			read(0, AUDIO_BLOCK_SAMPLES - n, block->data + n);
+		read_delayed(delay_length[channel], block->data);
+		if (fading) {
+			// move from the old delay to the new one over this block,
+			// rather than jumping between two points in the signal
+			audio_block_t *old = allocate();
+			if (old) {
+				read_delayed(fade_length[channel], old->data);
+				float step = 1.0f / AUDIO_BLOCK_SAMPLES;
+				audio_scale_line(block->data, block->data, 0.0f, step);
+				audio_scale_add_line(block->data, old->data, 1.0f, -step);
+				release(old);
+			}
 		}
 		transmit(block, channel);
 		release(block);
 	}
 }
 
+// read a block from a delay of length samples before the head
+void AudioEffectDelayExternal::read_delayed(uint32_t length, float *data) {
+	uint32_t n, read_offset;
+
+	// compute the delayed location where we read
+	if (length <= head_offset) {
+		read_offset = head_offset - length;
+	} else {
+		read_offset = memory_length + head_offset - length;
+	}
+	if (read_offset + AUDIO_BLOCK_SAMPLES <= memory_length) {
+		// a single read will do it
+		read(read_offset, AUDIO_BLOCK_SAMPLES, data);
+	} else {
+		// read wraps across end-of-memory
+		n = memory_length - read_offset;
+		read(read_offset, n, data);
+		read(0, AUDIO_BLOCK_SAMPLES - n, data + n);
+	}
+}
+
 void AudioEffectDelayExternal::initialize(uint32_t samples) {
-	memory_begin = (uint32_t)ps_malloc(samples * sizeof(float));
-  if(memory_begin != 0) {
+	memory_begin = (float *)ps_malloc(samples * sizeof(float));
+  if(memory_begin != NULL) {
 	    memory_type = AUDIO_MEMORY_SPIRAM;
       memory_length = samples;
 	    zero(0, samples);
+	    zero_count = samples;
 	} else {
 		  memory_type = AUDIO_MEMORY_UNDEFINED;
 	}
 }
 
 void AudioEffectDelayExternal::read(uint32_t offset, uint32_t count, float *data) {
-	uint32_t addr = memory_begin + offset * sizeof(float);
-  memcpy((void *)data, (const void *)addr, count * sizeof(float));
+	audio_copy(data, memory_begin + offset, count);
 }
 
 void AudioEffectDelayExternal::write(uint32_t offset, uint32_t count, const float *data) {
-	uint32_t addr = memory_begin + offset * sizeof(float);
-  memcpy((void *)addr, (const void *)data, count * sizeof(float));
+	audio_copy(memory_begin + offset, data, count);
+}
+
+void AudioEffectDelayExternal::zero(uint32_t offset, uint32_t count) {
+	audio_fill(memory_begin + offset, 0.0f, count);
 }
@@ -25,6 +25,7 @@
  */
 
 #include "effect_envelope.h"
+#include "AudioKernels.h"
 
 #define STATE_IDLE	0
 #define STATE_DELAY	1
@@ -37,6 +38,7 @@
 
 void AudioEffectEnvelope::noteOn(void)
 {
+	if (post(COMMAND_NOTE_ON)) return;
 	//__disable_irq();
 	if (state == STATE_IDLE || state == STATE_DELAY || release_forced_count == 0) {
 		mult_hires = 0;
@@ -59,6 +61,7 @@ void AudioEffectEnvelope::noteOn(void)
 
 void AudioEffectEnvelope::noteOff(void)
 {
+	if (post(COMMAND_NOTE_OFF)) return;
 	//__disable_irq();
 	if (state != STATE_IDLE && state != STATE_FORCED) {
 		state = STATE_RELEASE;
@@ -77,8 +80,11 @@ void IRAM_ATTR AudioEffectEnvelope::update(void)
     //Serial.println(state);
 
 	block = receiveWritable();
-	if (!block) return;
-	if (state == STATE_IDLE) {
+	if (!block) {
+		apply_events(AUDIO_BLOCK_SAMPLES);
+		return;
+	}
+	if (state == STATE_IDLE && events.empty()) {
 		release(block);
 		return;
 	}
@@ -87,6 +93,7 @@ void IRAM_ATTR AudioEffectEnvelope::update(void)
 	//end = p + AUDIO_BLOCK_SAMPLES/2;
 
     for(int i = 0; i < AUDIO_BLOCK_SAMPLES; i += 8){
+		apply_events(i);
 		// we only care about the state when completing a region
 		if (count == 0) {
 			if (state == STATE_ATTACK) {
@@ -134,6 +141,12 @@ void IRAM_ATTR AudioEffectEnvelope::update(void)
 			}
 		}
 
+		if (state == STATE_IDLE) {
+			// before a timed noteOn, or after the release ended
+			audio_fill(block->data + i, 0.0f, 8);
+			continue;
+		}
+
 		const float conversion = (1.0f / 65535.0f);
 		float mult = (mult_hires >> 14) * conversion;
 		float inc = (inc_hires >> 17) * conversion;
@@ -159,6 +172,7 @@ void IRAM_ATTR AudioEffectEnvelope::update(void)
 		mult_hires += inc_hires;
 		count--;
 	}
+	apply_events(AUDIO_BLOCK_SAMPLES);
 
 	transmit(block);
 	release(block);
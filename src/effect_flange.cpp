@@ -64,7 +64,8 @@ boolean AudioEffectFlange::voices(int delay_offset,int d_depth,float delay_rate)
   
   delay_depth = d_depth;
 
-  delay_rate_incr =(delay_rate * 2147483648.0)/ AUDIO_SAMPLE_RATE_EXACT;
+  this->delay_rate = delay_rate;
+  sample_rate_changed();  // LFO phase increment, as a fraction of 2*PI
   
   delay_offset_idx = delay_offset;
   // Allow the passthru code to go through
@@ -94,7 +95,8 @@ boolean AudioEffectFlange::begin(float *delayline,int d_length,int delay_offset,
   l_delay_rate_phase = 0;
   l_circ_idx = 0;
   //delay_rate_incr =(delay_rate * 2147483648.0)/ AUDIO_SAMPLE_RATE_EXACT;
-  delay_rate_incr = (float)(( 2.0 * PI ) / ( (float)AUDIO_SAMPLE_RATE_EXACT * 1.0 ));
+  this->delay_rate = delay_rate;
+  sample_rate_changed();
   
   delay_offset_idx = delay_offset;
   // Allow the passthru code to go through
@@ -25,6 +25,7 @@
  */
 
 #include "effect_multiply.h"
+#include "AudioKernels.h"
 
 void AudioEffectMultiply::update(void)
 {
@@ -41,10 +42,7 @@ void AudioEffectMultiply::update(void)
 		return;
 	}
 
-	for(int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
-    {
-        blocka->data[i] *= blockb->data[i];
-	}
+	audio_multiply(blocka->data, blocka->data, blockb->data);
 	transmit(blocka);
 	release(blocka);
 	release(blockb);
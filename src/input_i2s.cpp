@@ -18,84 +18,23 @@ void IRAM_ATTR AudioInputI2S::update(void)
 
 		//Serial.println("update");
 
-		size_t bytesRead = 0;
-		//i2s_adc_enable(I2S_NUM_0);
-		switch(AudioControlI2S::bits)
-		{
-			case 16:
-				i2s_read(I2S_NUM_0, (char*)&inputSampleBuffer, (AUDIO_BLOCK_SAMPLES * sizeof(uint32_t)), &bytesRead, portMAX_DELAY);		//Block but yield to other tasks
-				break;
-			case 24:
-			case 32:
-				i2s_read(I2S_NUM_0, (char*)&inputSampleBuffer, (AUDIO_BLOCK_SAMPLES * sizeof(uint32_t)) * 2, &bytesRead, portMAX_DELAY);		//Block but yield to other tasks
-				break;
-			default:
-				printf("Unknown bit depth\n");
-				break;
+		if (AudioControlI2S::resync_due()) AudioControlI2S::restart();
+
+		// returns as soon as the driver has filled a block
+		AudioControlI2S::read(inputSampleBuffer, AudioControlI2S::block_bytes());
+
+		uint32_t left_bits = 0, right_bits = 0;
+		if (new_left != NULL) {
+			AudioControlI2S::unpack(inputSampleBuffer, new_left->data, new_right->data, left_bits, right_bits);
+		}
+		// digital silence goes out as no block at all
+		if (new_left) {
+			if (left_bits) transmit(new_left, 0);
+			release(new_left);
 		}
-		union foo input;
-		union foo output;
-		switch(AudioControlI2S::bits)
-		{
-			case 16:
-				for(int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
-				{
-					if(new_left != NULL)
-					{
-						new_left->data[i] = ((float)(inputSampleBuffer[i] & 0xfff)/2048.0f) - 1.0f;
-					}
-				}
-				break;
-			case 24:
-				for(int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
-				{
-					if(new_left != NULL)
-					{
-						input.integer = inputSampleBuffer[i*2];
-						output.byte[0] = input.byte[1];
-						output.byte[1] = input.byte[2];
-						output.byte[2] = input.byte[3];
-						if(CHECK_BIT(output.byte[2], 7))
-						{
-							output.byte[3] = 0xFF;
-						}
-						else
-							output.byte[3] = 0x00;
-						new_left->data[i] = ((float)output.integer)/8388608.0f;
-					}
-					if(new_right != NULL)
-					{
-						input.integer = inputSampleBuffer[i*2 + 1];
-						output.byte[0] = input.byte[1];
-						output.byte[1] = input.byte[2];
-						output.byte[2] = input.byte[3];
-						if(CHECK_BIT(output.byte[2], 7))
-						{
-							output.byte[3] = 0xFF;
-						}
-						else
-							output.byte[3] = 0x00;
-						new_right->data[i] = ((float)output.integer)/8388608.0f;
-					}
-				}
-				break;
-			case 32:
-				for(int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
-				{
-					if(new_left != NULL)
-					{
-						new_left->data[i] = ((float)inputSampleBuffer[i*2])/1073741823.0f;
-					}
-					if(new_right != NULL)
-					{
-						new_right->data[i] = ((float)inputSampleBuffer[i*2+1])/1073741823.0f;
-					}
-				}
-				break;
+		if (new_right) {
+			if (right_bits) transmit(new_right, 1);
+			release(new_right);
 		}
-		transmit(new_left, 0);
-		release(new_left);
-		transmit(new_right, 1);
-		release(new_right);		
 	}
 }
\ No newline at end of file
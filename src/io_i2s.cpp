@@ -0,0 +1,49 @@
+#include "io_i2s.h"
+#include "Arduino.h"
+
+void IRAM_ATTR AudioIOI2S::update(void)
+{
+	audio_block_t *block_left, *block_right, *new_left = NULL, *new_right = NULL;
+
+	if(!AudioControlI2S::configured) return;
+
+	// from the top after a glitch, with resync on
+	if (!started || AudioControlI2S::resync_due()) {
+		AudioControlI2S::restart();
+		started = true;
+	}
+
+	// out: what the graph made of the last block in
+	block_left = receiveReadOnly(0);
+	block_right = receiveReadOnly(1);
+	AudioControlI2S::pack(sampleBuffer, block_left ? block_left->data : NULL,
+		block_right ? block_right->data : NULL);
+	if (block_left) release(block_left);
+	if (block_right) release(block_right);
+	AudioControlI2S::write(sampleBuffer, AudioControlI2S::block_bytes());
+
+	// in: the next block, read into the same buffer
+	AudioControlI2S::read(sampleBuffer, AudioControlI2S::block_bytes());
+	new_left = allocate();
+	if (new_left != NULL) {
+		new_right = allocate();
+		if (new_right == NULL) {
+			release(new_left);
+			new_left = NULL;
+		}
+	}
+	if (new_left == NULL) return;
+
+	uint32_t left_bits, right_bits;
+	AudioControlI2S::unpack(sampleBuffer, new_left->data, new_right->data, left_bits, right_bits);
+	// digital silence goes out as no block at all
+	if (left_bits) transmit(new_left, 0);
+	release(new_left);
+	if (right_bits) transmit(new_right, 1);
+	release(new_right);
+}
+
+uint32_t AudioIOI2S::latencySamples(void)
+{
+	return AUDIO_BLOCK_SAMPLES + AudioControlI2S::latencySamples();
+}
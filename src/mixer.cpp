@@ -25,29 +25,43 @@
  */
 
 #include "mixer.h"
+#include "AudioKernels.h"
 
 #define MULTI_UNITYGAIN 1.0
 
-static void applyGain(float *data, float mult)
+static void applyGainRamp(float *data, AudioSmoothedValue &mult, unsigned int n = AUDIO_BLOCK_SAMPLES)
+{
+    for(unsigned int i = 0; i < n; i++)
+    {
+        data[i] *= mult.next();
+    }
+}
+
+static void applyGainRampThenAdd(float *dst, const float *src, AudioSmoothedValue &mult)
 {
     for(int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
     {
-        data[i] *= mult;
+        dst[i] += src[i] * mult.next();
     }
 }
 
+// a gain moving in a straight line from start to end over the block
+static void applyGainLine(float *data, float start, float end)
+{
+    audio_scale_line(data, data, start, (end - start) / AUDIO_BLOCK_SAMPLES);
+}
+
+static void applyGainLineThenAdd(float *dst, const float *src, float start, float end)
+{
+    audio_scale_add_line(dst, src, start, (end - start) / AUDIO_BLOCK_SAMPLES);
+}
+
 static void applyGainThenAdd(float *dst, const float *src, float mult)
 {
 	if (mult == MULTI_UNITYGAIN) {
-        for(int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
-        {
-            dst[i] += src[i];
-        }
+        audio_add(dst, src);
 	} else {
-        for(int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
-        {
-            dst[i] += src[i] * mult;
-        }
+        audio_scale_add(dst, src, mult);
 	}
 }
 
@@ -57,16 +71,28 @@ void IRAM_ATTR AudioMixer4::update(void)
 	unsigned int channel;
 
 	for (channel=0; channel < 4; channel++) {
+		AudioSmoothedValue &mult = multiplier[channel];
+		float start, end;
+		bool line = receiveControl(channel, start, end);
+		if (line) mult.jump(end);
 		if (!out) {
 			out = receiveWritable(channel);
 			if (out) {
-				if (multiplier[channel] != MULTI_UNITYGAIN) applyGain(out->data, multiplier[channel]);
+				if (line) applyGainLine(out->data, start, end);
+				else if (mult.ramping()) applyGainRamp(out->data, mult);
+				else if (mult.value() != MULTI_UNITYGAIN) audio_scale(out->data, out->data, mult.value());
+			} else {
+				mult.skip(AUDIO_BLOCK_SAMPLES);
 			}
 		} else {
 			in = receiveReadOnly(channel);
 			if (in) {
-				applyGainThenAdd(out->data, in->data, multiplier[channel]);
+				if (line) applyGainLineThenAdd(out->data, in->data, start, end);
+				else if (mult.ramping()) applyGainRampThenAdd(out->data, in->data, mult);
+				else applyGainThenAdd(out->data, in->data, mult.value());
 				release(in);
+			} else {
+				mult.skip(AUDIO_BLOCK_SAMPLES);
 			}
 		}
 	}
@@ -76,12 +102,76 @@ void IRAM_ATTR AudioMixer4::update(void)
 	}
 }
 
+// gain changes timed inside this block: apply each from its sample on
+void AudioAmplifier::update_events(void)
+{
+	audio_block_t *block = receiveWritable(0);
+	unsigned int i = 0, n;
+
+	do {
+		n = events.next();
+		if (!block) {
+			multiplier.skip(n - i);
+		} else if (multiplier.ramping()) {
+			applyGainRamp(block->data + i, multiplier, n - i);
+		} else if (multiplier.value() != MULTI_UNITYGAIN) {
+			audio_scale(block->data + i, block->data + i, multiplier.value(), n - i);
+		}
+		if (n < AUDIO_BLOCK_SAMPLES) {
+			const AudioBlockEvents::event &e = events.pop();
+			command(e.id, e.value, 0);
+		}
+		i = n;
+	} while (i < AUDIO_BLOCK_SAMPLES);
+	if (block) {
+		transmit(block);
+		release(block);
+	}
+}
+
+// the gain comes from the control input: a straight line over the block
+void AudioAmplifier::update_control(float start, float end)
+{
+	audio_block_t *block;
+
+	while (!events.empty()) {
+		const AudioBlockEvents::event &e = events.pop();
+		command(e.id, e.value, 0);
+	}
+	multiplier.jump(end);
+	if (start == 0.0f && end == 0.0f) {
+		block = receiveReadOnly(0);
+		if (block) release(block);
+		return;
+	}
+	block = receiveWritable(0);
+	if (block) {
+		applyGainLine(block->data, start, end);
+		transmit(block);
+		release(block);
+	}
+}
+
 void IRAM_ATTR AudioAmplifier::update(void)
 {
 	audio_block_t *block;
-	float mult = multiplier;
+	float mult = multiplier.value();
+	float start, end;
 
-	if (mult == 0) {
+	if (receiveControl(0, start, end)) {
+		update_control(start, end);
+	} else if (!events.empty()) {
+		update_events();
+	} else if (multiplier.ramping()) {
+		block = receiveWritable(0);
+		if (block) {
+			applyGainRamp(block->data, multiplier);
+			transmit(block);
+			release(block);
+		} else {
+			multiplier.skip(AUDIO_BLOCK_SAMPLES);
+		}
+	} else if (mult == 0) {
 		// zero gain, discard any input and transmit nothing
 		block = receiveReadOnly(0);
 		if (block) release(block);
@@ -96,7 +186,7 @@ void IRAM_ATTR AudioAmplifier::update(void)
 		// apply gain to signal
 		block = receiveWritable(0);
 		if (block) {
-			applyGain(block->data, mult);
+			audio_scale(block->data, block->data, mult);
 			transmit(block);
 			release(block);
 		}
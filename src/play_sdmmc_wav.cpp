@@ -1,4 +1,5 @@
 #include "play_sdmmc_wav.h"
+#include "AudioKernels.h"
 #define DR_WAV_IMPLEMENTATION
 
 // U3 card, 40Mhz, 256 samples (1024 bytes) i16 - 12.3% / 15% / 12.8%
@@ -132,9 +133,10 @@ void AudioPlaySdMmcWav::playFile(const char *filename)
 
     sampleBufferSize = pWav->channels * AUDIO_BLOCK_SAMPLES;
     ESP_LOGI(TAG, "Sample buffer size: %i, allocating %i bytes.", sampleBufferSize, sampleBufferSize * sizeof(float));
-    pSampleData = (float*)heap_caps_malloc(sampleBufferSize * sizeof(float), MALLOC_CAP_DMA);
+    pSampleData = heap_caps_malloc(sampleBufferSize * sizeof(float), MALLOC_CAP_DMA);
 
-    drwav_read_f32(pWav, sampleBufferSize, pSampleData);     //Read 256 samples
+    pcm = pWav->translatedFormatTag == DR_WAVE_FORMAT_PCM;
+    readSamples();
 
     samplePointer = 0;
     fileBlockPointer = 0;
@@ -144,10 +146,23 @@ void AudioPlaySdMmcWav::playFile(const char *filename)
     playback = true;
 }
 
+// PCM comes as 32-bit, whatever the file has, for update() to convert
+// and split into blocks in one go
+void AudioPlaySdMmcWav::readSamples(void)
+{
+    if(pcm)
+        drwav_read_s32(pWav, sampleBufferSize, (drwav_int32*)pSampleData);
+    else
+        drwav_read_f32(pWav, sampleBufferSize, (float*)pSampleData);
+}
+
  void IRAM_ATTR AudioPlaySdMmcWav::update(void)
  {
     audio_block_t *new_left=NULL, *new_right=NULL;
 
+    // nothing playing, transmit nothing rather than blocks of garbage
+    if(!(configured && fileLoaded && playback)) return;
+
     new_left = allocate();
     if (new_left != NULL) {
         new_right = allocate();
@@ -157,32 +172,43 @@ void AudioPlaySdMmcWav::playFile(const char *filename)
         }
     }
 
-    if(configured && fileLoaded && playback)
+    if(new_left != NULL)
     { 
-        switch(pWav->channels)
+        if(pcm)
+        {
+            const int32_t *src = (const int32_t*)pSampleData + samplePointer;
+            audio_from_pcm(new_left->data, src, pWav->channels, 32, 1.0f / 2147483648.0f);
+            if(pWav->channels == 2)
+                audio_from_pcm(new_right->data, src + 1, 2, 32, 1.0f / 2147483648.0f);
+            else
+                audio_copy(new_right->data, new_left->data);     //Mono
+        }
+        else
         {
-            case 1:
-                for(int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
-                {
-                    new_left->data[i] = pSampleData[samplePointer++];
-                    new_right->data[i] = new_left->data[i];     //Mono
-                }
-                break;
-            case 2:
-                for(int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
-                {
-                    new_left->data[i] = pSampleData[samplePointer++];
-                    new_right->data[i] = pSampleData[samplePointer++];
-                }   
-                break;           
+            const float *src = (const float*)pSampleData + samplePointer;
+            switch(pWav->channels)
+            {
+                case 1:
+                    audio_copy(new_left->data, src);
+                    audio_copy(new_right->data, src);     //Mono
+                    break;
+                case 2:
+                    for(int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
+                    {
+                        new_left->data[i] = src[i*2];
+                        new_right->data[i] = src[i*2 + 1];
+                    }
+                    break;
+            }
         }
+        samplePointer += pWav->channels * AUDIO_BLOCK_SAMPLES;
         if(samplePointer == sampleBufferSize)
         {
             samplePointer = 0;
             fileBlockPointer++;
             if(fileBlockPointer < fileBlockPointerMax)
             {
-                drwav_read_f32(pWav, sampleBufferSize, pSampleData);
+                readSamples();
             }
             else
             {
@@ -191,8 +217,11 @@ void AudioPlaySdMmcWav::playFile(const char *filename)
         }     
     }
 
-    transmit(new_left, 0);
-    release(new_left);
-    transmit(new_right, 1);
-    release(new_right);	
+    if(new_left != NULL)
+    {
+        transmit(new_left, 0);
+        release(new_left);
+        transmit(new_right, 1);
+        release(new_right);
+    }
  }
\ No newline at end of file
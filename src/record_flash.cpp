@@ -12,6 +12,10 @@
 
 static const char *TAG = "record_flash";
 
+// written for silence, which comes as no block; in RAM, as the flash
+// can't be read while it is written
+static DRAM_ATTR float silence[AUDIO_BLOCK_SAMPLES];
+
 void AudioRecordFlash::init()
 {
     printf("Erasing flash \n");
@@ -42,12 +46,11 @@ void IRAM_ATTR AudioRecordFlash::update(void)
     if(record)
     {
         block = receiveReadOnly();
-	    if (!block) return;
 
         if (data_partition != NULL)
         {
             printf("Writing to partition\n");
-            esp_partition_write(data_partition, recordPointer, (char *)block->data, AUDIO_BYTES);
+            esp_partition_write(data_partition, recordPointer, (char *)(block ? block->data : silence), AUDIO_BYTES);
             printf("Finished writing to partition\n");
             recordPointer += AUDIO_BYTES;
             if(recordPointer >= MAX_RECORD)
@@ -56,7 +59,7 @@ void IRAM_ATTR AudioRecordFlash::update(void)
             }
         }
 
-        release(block);
+        if (block) release(block);
     }
 
     if(playing)
@@ -1,4 +1,5 @@
 #include "record_psram.h"
+#include "AudioKernels.h"
 
 void AudioRecordPSRAM::init(int num)
 {
@@ -22,13 +23,13 @@ void IRAM_ATTR AudioRecordPSRAM::update(void)
     if(record)
     {
         block = receiveReadOnly();
-	    if (!block) return;
 
         //printf("Storing audio in buffer %i\n", recordPointer);
-        for(int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
-        {
-            buffer[recordPointer].data[i] = block->data[i];
-        }
+        // silence comes as no block, and is recorded all the same
+        if (block)
+            audio_copy(buffer[recordPointer].data, block->data);
+        else
+            audio_fill(buffer[recordPointer].data, 0.0f);
         recordPointer++;
 
         if(recordPointer >= RECORD_PSRAM_BLOCK_MAX)
@@ -37,7 +38,7 @@ void IRAM_ATTR AudioRecordPSRAM::update(void)
             recordPointer = RECORD_PSRAM_BLOCK_MAX;
         }
 
-        release(block);
+        if (block) release(block);
     }
 
     if(playing)
@@ -45,10 +46,7 @@ void IRAM_ATTR AudioRecordPSRAM::update(void)
         block = allocate();
         if(!block) return;
 
-        for(int i = 0; i < AUDIO_BLOCK_SAMPLES; i++)
-        {
-            block->data[i] = buffer[playPointer].data[i];
-        }
+        audio_copy(block->data, buffer[playPointer].data);
         playPointer++;
 
         if(playPointer >= recordPointer)
@@ -0,0 +1,59 @@
+#include "synth_control.h"
+#include <math.h>
+
+void AudioSynthControlLFO::update(void)
+{
+	float value;
+
+	phase += increment;
+	phase -= (int)phase;
+	switch (shape) {
+	case WAVEFORM_TRIANGLE:
+		value = (phase < 0.5f) ? 4.0f * phase - 1.0f : 3.0f - 4.0f * phase;
+		break;
+	case WAVEFORM_SQUARE:
+		value = (phase < 0.5f) ? 1.0f : -1.0f;
+		break;
+	case WAVEFORM_SAWTOOTH:
+		value = 2.0f * phase - 1.0f;
+		break;
+	case WAVEFORM_SAWTOOTH_REVERSE:
+		value = 1.0f - 2.0f * phase;
+		break;
+	default:
+		value = sinf(2.0f * (float)PI * phase);
+		break;
+	}
+	transmitControl(level + magnitude * value);
+}
+
+void AudioSynthControlEnvelope::update(void)
+{
+	switch (state) {
+	case STATE_ATTACK:
+		level += attack_step;
+		if (level >= 1.0f) {
+			level = 1.0f;
+			state = STATE_DECAY;
+		}
+		break;
+	case STATE_DECAY:
+		level -= decay_step;
+		if (level <= sustain_level) {
+			level = sustain_level;
+			state = STATE_SUSTAIN;
+		}
+		break;
+	case STATE_SUSTAIN:
+		level = sustain_level;
+		break;
+	case STATE_RELEASE:
+		level -= release_step;
+		if (level <= 0.0f) {
+			level = 0.0f;
+			state = STATE_IDLE;
+		}
+		break;
+	}
+	transmitControl(level);
+}
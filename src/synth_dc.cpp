@@ -1,14 +1,14 @@
 #include "synth_dc.h"
+#include "AudioKernels.h"
 
 void IRAM_ATTR AudioSynthWaveformDc::update(void)
 {
 	audio_block_t *block;
 
+    if (dcValue == 0.0f) return;	// silence, transmit nothing
     block = allocate();
     if (block) {
-        for (int i=0; i < AUDIO_BLOCK_SAMPLES; i++) {
-            block->data[i] = dcValue;
-        }
+        audio_fill(block->data, dcValue);
                     
         AudioStream::transmit(block);
         AudioStream::release(block);
@@ -28,36 +28,28 @@
 #include "AudioStream.h"
 #include "synth_waveform.h"
 
-void AudioSynthWaveform::update(void)
+// n samples of the waveform from phase ph, returning the phase after them
+float AudioSynthWaveform::render(float *bp, uint32_t n, float ph)
 {
-	audio_block_t *block;
-	float *bp, *end;
 	float val1, val2;
 	uint32_t i, index, index2;
-	float ph, scale;
+	float scale;
 	float inc = phase_increment;
 
 	float rise = (pulse_width == 0 ? 3.4E+38 : 1 / pulse_width);       // prevent division by zero 
 	float fall = (pulse_width == 1 ? 1.5E-45 : 1 / (1 - pulse_width)); // prevent division by zero 
 
-	ph = phase_accumulator + phase_offset;
-	if(ph > 1) ph -= 1; 
-
-	if (magnitude == 0) {
-		phase_accumulator += inc * AUDIO_BLOCK_SAMPLES;
-		return;
-	}
-	block = allocate();
-	if (!block) {
-		phase_accumulator += inc * AUDIO_BLOCK_SAMPLES;
-		Serial.println(".");
-		return;
-	}
-	bp = block->data;
-
 	switch(tone_type) {
 	case WAVEFORM_SINE:
-		for (i=0; i < AUDIO_BLOCK_SAMPLES; i++) { 
+		if (degraded == DEGRADE_QUALITY) {
+			// under load, the nearest table entry without interpolation
+			for (i=0; i < n; i++) {
+				*bp++ = AudioWaveformSine[(int)(ph * 256)] * magnitude + tone_offset;
+				ph += inc; if(ph > 1) ph -= 1; 
+			}
+			break;
+		}
+		for (i=0; i < n; i++) { 
 			index = (int)(ph * 256);
 			scale = ph * 256 - index;
       val1 = AudioWaveformSine[index];
@@ -69,12 +61,7 @@ void AudioSynthWaveform::update(void)
 		break;
 
 	case WAVEFORM_ARBITRARY: // NOT TESTED YET!
-		if (!arbdata) {
-			release(block);
-			phase_accumulator += inc * AUDIO_BLOCK_SAMPLES;
-			return;
-		}
-		for (i=0; i < AUDIO_BLOCK_SAMPLES; i++) {
+		for (i=0; i < n; i++) {
 			index = (int)(ph * 256); 
 			index2 = index + 1;
 			if (index2 >= 256) index2 = 0;
@@ -87,7 +74,7 @@ void AudioSynthWaveform::update(void)
 		break;
 
 	case WAVEFORM_SQUARE:
-		for (i=0; i < AUDIO_BLOCK_SAMPLES; i++) {
+		for (i=0; i < n; i++) {
 			if (ph > 0.5) {
 				*bp++ = tone_offset; 
 			} else {
@@ -98,21 +85,21 @@ void AudioSynthWaveform::update(void)
 		break;
 
 	case WAVEFORM_SAWTOOTH:
-		for (i=0; i < AUDIO_BLOCK_SAMPLES; i++) {
+		for (i=0; i < n; i++) {
 			*bp++ = magnitude * ph + tone_offset; 
 			ph += inc; if(ph > 1) ph -= 1; 
 		}
 		break;
 
 	case WAVEFORM_SAWTOOTH_REVERSE:
-		for (i=0; i < AUDIO_BLOCK_SAMPLES; i++) {
+		for (i=0; i < n; i++) {
 			*bp++ = magnitude - magnitude * ph + tone_offset;
 			ph += inc; if(ph > 1) ph -= 1; 
 		}
 		break;
 
 	case WAVEFORM_TRIANGLE:
-		for (i=0; i < AUDIO_BLOCK_SAMPLES; i++) {
+		for (i=0; i < n; i++) {
 			if (ph < 0.5) {
 				*bp++ = ph * 2 * magnitude + tone_offset;
 			} else {
@@ -123,7 +110,7 @@ void AudioSynthWaveform::update(void)
 		break;
 
 	case WAVEFORM_TRIANGLE_VARIABLE:
-		for (i=0; i < AUDIO_BLOCK_SAMPLES; i++) {
+		for (i=0; i < n; i++) {
 			if (ph < pulse_width) {
 				*bp++ = ph * rise * magnitude;
 			} else {
@@ -134,7 +121,7 @@ void AudioSynthWaveform::update(void)
 		break;
 
 	case WAVEFORM_PULSE:
-		for (i=0; i < AUDIO_BLOCK_SAMPLES; i++) {
+		for (i=0; i < n; i++) {
 			if (ph < pulse_width) {
 				*bp++ = magnitude + tone_offset;
 			} else {
@@ -145,7 +132,7 @@ void AudioSynthWaveform::update(void)
 		break;
 
 	case WAVEFORM_SAMPLE_HOLD:
-		for (i=0; i < AUDIO_BLOCK_SAMPLES; i++) {
+		for (i=0; i < n; i++) {
 			*bp++ = sample;
 			float newph = ph + inc;
 			if (newph < ph) {
@@ -156,10 +143,45 @@ void AudioSynthWaveform::update(void)
 		break;
 	}
 
+	return ph;
+}
+
+void AudioSynthWaveform::update(void)
+{
+	audio_block_t *block = NULL;
+	float ph;
+	uint32_t i = 0, n;
+
+	ph = phase_accumulator + phase_offset;
+	if(ph > 1) ph -= 1; 
+
+	if (magnitude != 0 && (tone_type != WAVEFORM_ARBITRARY || arbdata)) {
+		block = allocate();
+		if (!block) Serial.println(".");
+	}
+
+	// frequency changes timed inside this block split it in parts
+	do {
+		n = events.next();
+		if (block) {
+			ph = render(block->data + i, n - i, ph);
+		} else {
+			ph += phase_increment * (n - i);
+			ph -= (int)ph;
+		}
+		if (n < AUDIO_BLOCK_SAMPLES) {
+			const AudioBlockEvents::event &e = events.pop();
+			command(e.id, e.value, 0);
+		}
+		i = n;
+	} while (i < AUDIO_BLOCK_SAMPLES);
+
 	phase_accumulator = ph - phase_offset;
 
-	transmit(block, 0);
-	release(block);
+	if (block) {
+		transmit(block, 0);
+		release(block);
+	}
 }
 
 //--------------------------------------------------------------------------------
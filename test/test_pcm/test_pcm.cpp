@@ -0,0 +1,157 @@
+// audio_from_pcm() and audio_to_pcm() against a plain conversion done
+// sample by sample in double, at the bit depths the I2S objects use.
+// pio test -e native
+#include <unity.h>
+#include <math.h>
+#include <stdlib.h>
+#include "AudioKernels.h"
+
+// odd, to run the one-at-a-time tail of the loops as well
+#define N 131
+
+static int32_t pcm[2 * N];
+static float samples[N];
+
+// a sample of bits bits, in the top of an int32_t
+static int32_t pcm_sample(int32_t value, unsigned int bits)
+{
+	return (int32_t)((uint32_t)value << (32 - bits));
+}
+
+// what audio_to_pcm() should make of x: x * scale toward zero, and
+// the nearest end of the range when it doesn't fit; NaN is the bottom
+static int32_t ref_to_pcm(float x, unsigned int bits, float scale)
+{
+	if (isnan(x)) return INT32_MIN;
+	double v = trunc((double)(x * scale));
+	double hi = (double)audio_pcm_max(bits), lo = -ldexp(1.0, bits - 1);
+	if (v > hi) v = hi;
+	if (v < lo) v = lo;
+	return pcm_sample((int32_t)v, bits);
+}
+
+// the top of the range, in the top of an int32_t; INT32_MIN is the bottom
+static int32_t pcm_top(unsigned int bits)
+{
+	return (int32_t)(0x7fffffffu & ~((1u << (32 - bits)) - 1));
+}
+
+#define PCM_BOTTOM INT32_MIN
+
+static int32_t random_value(unsigned int bits)
+{
+	uint64_t r = ((uint64_t)rand() << 33) ^ ((uint64_t)rand() << 10) ^ (uint64_t)rand();
+	return (int32_t)((int64_t)r >> (64 - bits));
+}
+
+static void check_from_pcm(unsigned int bits)
+{
+	const float scale = (float)ldexp(1.0, 1 - (int)bits);
+	uint32_t any = 0;
+
+	for (int i = 0; i < N; i++) {
+		pcm[2 * i] = pcm_sample(random_value(bits), bits);
+		pcm[2 * i + 1] = 0x5a5a5a5a;		// the other channel, not read
+		any |= (uint32_t)(pcm[2 * i] >> (32 - bits));
+	}
+	pcm[0] = PCM_BOTTOM;
+	pcm[2] = pcm_top(bits);
+	any |= (uint32_t)(pcm[0] >> (32 - bits)) | (uint32_t)(pcm[2] >> (32 - bits));
+
+	TEST_ASSERT_EQUAL_HEX32(any, audio_from_pcm(samples, pcm, 2, bits, scale, N));
+	for (int i = 0; i < N; i++) {
+		double expect = (double)(pcm[2 * i] >> (32 - bits)) * ldexp(1.0, 1 - (int)bits);
+		TEST_ASSERT_EQUAL_FLOAT((float)expect, samples[i]);
+		TEST_ASSERT_TRUE(samples[i] >= -1.0f && samples[i] <= 1.0f);
+	}
+}
+
+static void check_to_pcm(unsigned int bits)
+{
+	const float scale = (float)ldexp(1.0, bits - 1);
+	const float edges[] = { 0.0f, 1.0f, -1.0f, 1.0f + 1e-6f, -1.0f - 1e-6f, 1.5f, -1.5f,
+		100.0f, -100.0f, INFINITY, -INFINITY, 0.999999f, -0.999999f, 0.5f, -0.5f, NAN };
+	const int n_edges = sizeof(edges) / sizeof(edges[0]);
+
+	for (int i = 0; i < N; i++) {
+		samples[i] = i < n_edges ? edges[i] : (float)rand() / RAND_MAX * 2.4f - 1.2f;
+	}
+	for (int i = 0; i < 2 * N; i++) pcm[i] = 0x5a5a5a5a;
+	audio_to_pcm(pcm + 1, 2, samples, bits, scale, N);
+	for (int i = 0; i < N; i++) {
+		TEST_ASSERT_EQUAL_HEX32(0x5a5a5a5a, pcm[2 * i]);
+		TEST_ASSERT_EQUAL_HEX32(ref_to_pcm(samples[i], bits, scale), pcm[2 * i + 1]);
+	}
+
+	// full scale and over saturate to the ends of the range, not wrap
+	const int32_t top = pcm_sample((int32_t)audio_pcm_max(bits), bits);
+	const int32_t bottom = PCM_BOTTOM;
+	TEST_ASSERT_EQUAL_HEX32(top, pcm[1 * 2 + 1]);
+	TEST_ASSERT_EQUAL_HEX32(bottom, pcm[2 * 2 + 1]);
+	TEST_ASSERT_EQUAL_HEX32(top, pcm[7 * 2 + 1]);
+	TEST_ASSERT_EQUAL_HEX32(bottom, pcm[8 * 2 + 1]);
+	TEST_ASSERT_EQUAL_HEX32(top, pcm[9 * 2 + 1]);
+	TEST_ASSERT_EQUAL_HEX32(bottom, pcm[10 * 2 + 1]);
+	TEST_ASSERT_EQUAL_HEX32(bottom, pcm[15 * 2 + 1]);
+
+	// no block is silence
+	for (int i = 0; i < 2 * N; i++) pcm[i] = 0x5a5a5a5a;
+	audio_to_pcm(pcm, 2, NULL, bits, scale, N);
+	for (int i = 0; i < N; i++) {
+		TEST_ASSERT_EQUAL_HEX32(0, pcm[2 * i]);
+		TEST_ASSERT_EQUAL_HEX32(0x5a5a5a5a, pcm[2 * i + 1]);
+	}
+}
+
+// what comes in goes back out unchanged
+static void check_round_trip(unsigned int bits)
+{
+	int32_t back[N];
+
+	for (int i = 0; i < N; i++) pcm[i] = pcm_sample(random_value(bits), bits);
+	audio_from_pcm(samples, pcm, 1, bits, (float)ldexp(1.0, 1 - (int)bits), N);
+	audio_to_pcm(back, 1, samples, bits, (float)ldexp(1.0, bits - 1), N);
+	for (int i = 0; i < N; i++) {
+		// 32 bits is more than a float holds: within its 24 bit mantissa
+		if (bits > 24)
+			TEST_ASSERT_INT32_WITHIN(1 << (bits - 24), pcm[i], back[i]);
+		else
+			TEST_ASSERT_EQUAL_HEX32(pcm[i], back[i]);
+	}
+}
+
+static void test_from_pcm_16(void) { check_from_pcm(16); }
+static void test_from_pcm_24(void) { check_from_pcm(24); }
+static void test_from_pcm_32(void) { check_from_pcm(32); }
+static void test_to_pcm_16(void) { check_to_pcm(16); }
+static void test_to_pcm_24(void) { check_to_pcm(24); }
+static void test_to_pcm_32(void) { check_to_pcm(32); }
+static void test_round_trip_16(void) { check_round_trip(16); }
+static void test_round_trip_24(void) { check_round_trip(24); }
+static void test_round_trip_32(void) { check_round_trip(32); }
+
+static void test_from_pcm_silence(void)
+{
+	for (int i = 0; i < N; i++) pcm[i] = 0;
+	TEST_ASSERT_EQUAL_HEX32(0, audio_from_pcm(samples, pcm, 1, 24, 1.0f / 8388608.0f, N));
+	for (int i = 0; i < N; i++) TEST_ASSERT_EQUAL_FLOAT(0.0f, samples[i]);
+}
+
+void setUp(void) { srand(1); }
+void tearDown(void) { }
+
+int main(int argc, char **argv)
+{
+	UNITY_BEGIN();
+	RUN_TEST(test_from_pcm_16);
+	RUN_TEST(test_from_pcm_24);
+	RUN_TEST(test_from_pcm_32);
+	RUN_TEST(test_from_pcm_silence);
+	RUN_TEST(test_to_pcm_16);
+	RUN_TEST(test_to_pcm_24);
+	RUN_TEST(test_to_pcm_32);
+	RUN_TEST(test_round_trip_16);
+	RUN_TEST(test_round_trip_24);
+	RUN_TEST(test_round_trip_32);
+	return UNITY_END();
+}